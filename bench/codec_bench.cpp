@@ -0,0 +1,265 @@
+/**
+ * @file      codec_bench.cpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Benchmark of the compression and decompression of the test
+ * images, run in-process through liblzcodec
+ *
+ * @date      12 April  2025 \n
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "lzcodec.hpp"
+
+// a combination of the -a and -m options
+struct Config {
+  std::string name;
+  bool adaptive;
+  bool model;
+};
+
+// medians of one file compressed with one configuration
+struct Result {
+  std::string file;
+  std::string config;
+  size_t original_size;
+  size_t compressed_size;
+  double compress_seconds;
+  double decompress_seconds;
+};
+
+// returns the median of the durations in seconds
+double median(std::vector<double> seconds) {
+  std::sort(seconds.begin(), seconds.end());
+  size_t middle = seconds.size() / 2;
+  if (seconds.size() % 2 == 0) {
+    return (seconds[middle - 1] + seconds[middle]) / 2;
+  }
+  return seconds[middle];
+}
+
+// returns the throughput in MB/s
+double throughput(size_t size, double seconds) {
+  return seconds > 0 ? size / seconds / 1e6 : 0.0;
+}
+
+// the width is the number the name starts with, 0 if there is none
+uint32_t width_from_name(const std::string& name) {
+  size_t digits = 0;
+  while (digits < name.size() && std::isdigit(name[digits])) {
+    digits++;
+  }
+  return digits > 0 ? std::stoul(name.substr(0, digits)) : 0;
+}
+
+std::string json_string(const std::string& text) {
+  std::string quoted = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+    }
+    quoted += c;
+  }
+  return quoted + "\"";
+}
+
+// compresses and decompresses the data, the first runs are not measured
+Result measure(const std::string& file, const std::vector<uint8_t>& data,
+               uint32_t width, const Config& config, int warmup,
+               int repetitions) {
+  lzcodec::CompressOptions options;
+  options.adaptive = config.adaptive;
+  options.model = config.model;
+
+  std::vector<double> compress_seconds;
+  std::vector<double> decompress_seconds;
+  size_t compressed_size = 0;
+  for (int r = 0; r < warmup + repetitions; r++) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint8_t> compressed = lzcodec::compress(data, width, options);
+    auto middle = std::chrono::steady_clock::now();
+    std::vector<uint8_t> decoded = lzcodec::decompress(compressed);
+    auto end = std::chrono::steady_clock::now();
+    if (r == 0 && decoded != data) {
+      throw std::runtime_error("Error: " + file + " with " + config.name +
+                               " does not decompress to the original.");
+    }
+    if (r < warmup) {
+      continue;
+    }
+    compressed_size = compressed.size();
+    compress_seconds.push_back(
+        std::chrono::duration<double>(middle - start).count());
+    decompress_seconds.push_back(
+        std::chrono::duration<double>(end - middle).count());
+  }
+  return {file,
+          config.name,
+          data.size(),
+          compressed_size,
+          median(compress_seconds),
+          median(decompress_seconds)};
+}
+
+void print_row(const std::string& file, const std::string& config,
+               size_t original_size, size_t compressed_size,
+               double compress_seconds, double decompress_seconds) {
+  std::cout << std::left << std::setw(40) << file << std::setw(8) << config
+            << std::right << std::setw(10) << original_size << std::setw(10)
+            << compressed_size << std::setw(10)
+            << static_cast<double>(original_size) / compressed_size
+            << std::setw(7) << 8.0 * compressed_size / original_size
+            << std::setw(10) << throughput(original_size, compress_seconds)
+            << std::setw(10) << throughput(original_size, decompress_seconds)
+            << std::endl;
+}
+
+void write_json(const std::string& filename,
+                const std::vector<Result>& results, int warmup,
+                int repetitions) {
+  std::ofstream json(filename);
+  if (!json) {
+    throw std::runtime_error("Error: Unable to open output file: " + filename);
+  }
+  json << std::fixed << std::setprecision(4);
+  json << "{\n  \"warmup\": " << warmup << ",\n  \"repetitions\": "
+       << repetitions << ",\n  \"results\": [";
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result& r = results[i];
+    json << (i > 0 ? "," : "") << "\n    {\"file\": " << json_string(r.file)
+         << ", \"config\": " << json_string(r.config)
+         << ", \"original_size\": " << r.original_size
+         << ", \"compressed_size\": " << r.compressed_size
+         << ", \"ratio\": "
+         << static_cast<double>(r.original_size) / r.compressed_size
+         << ", \"bits_per_pixel\": "
+         << 8.0 * r.compressed_size / r.original_size
+         << ", \"compress_mb_s\": "
+         << throughput(r.original_size, r.compress_seconds)
+         << ", \"decompress_mb_s\": "
+         << throughput(r.original_size, r.decompress_seconds) << "}";
+  }
+  json << "\n  ]\n}" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  int warmup = 1;
+  int repetitions = 3;
+  std::string json_filename;
+  std::vector<std::string> directories;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--warmup" && i + 1 < argc) {
+      warmup = std::stoi(argv[++i]);
+    } else if (arg == "--repetitions" && i + 1 < argc) {
+      repetitions = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--json" && i + 1 < argc) {
+      json_filename = argv[++i];
+    } else {
+      directories.push_back(arg);
+    }
+  }
+  if (directories.empty()) {
+    directories = {"data", "extra", "large_benchmark"};
+  }
+
+  // the raw images of every directory, named by their width
+  std::vector<std::filesystem::path> files;
+  for (const auto& directory : directories) {
+    if (!std::filesystem::is_directory(directory)) {
+      std::cerr << "Warning: " << directory << " is not a directory. Skipping."
+                << std::endl;
+      continue;
+    }
+    std::vector<std::filesystem::path> listed;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+      if (entry.is_regular_file() && entry.path().extension() == ".raw") {
+        listed.push_back(entry.path());
+      }
+    }
+    std::sort(listed.begin(), listed.end());
+    files.insert(files.end(), listed.begin(), listed.end());
+  }
+
+  const std::vector<Config> configs = {
+      {"base", false, false},
+      {"-m", false, true},
+      {"-a", true, false},
+      {"-a -m", true, true},
+  };
+  std::vector<Result> results;
+
+  std::cout << "Median of " << repetitions << " runs after " << warmup
+            << " warm-up runs, MB/s of the original size" << std::endl;
+  std::cout << std::left << std::setw(40) << "file" << std::setw(8)
+            << "config" << std::right << std::setw(10) << "size"
+            << std::setw(10) << "coded" << std::setw(10) << "ratio"
+            << std::setw(7) << "bpp" << std::setw(10) << "comp"
+            << std::setw(10) << "decomp" << std::endl;
+  std::cout << std::fixed << std::setprecision(2);
+  try {
+    for (const auto& path : files) {
+      uint32_t width = width_from_name(path.filename().string());
+      std::ifstream input(path, std::ios::binary);
+      std::vector<uint8_t> data((std::istreambuf_iterator<char>(input)),
+                                std::istreambuf_iterator<char>());
+      if (width == 0 || data.empty() || data.size() % width != 0) {
+        std::cerr << "Warning: No width of " << path.string()
+                  << " in its name. Skipping." << std::endl;
+        continue;
+      }
+      for (const auto& config : configs) {
+        results.push_back(measure(path.string(), data, width, config, warmup,
+                                  repetitions));
+        const Result& r = results.back();
+        print_row(r.file, r.config, r.original_size, r.compressed_size,
+                  r.compress_seconds, r.decompress_seconds);
+      }
+    }
+
+    // every configuration over all the files
+    for (const auto& config : configs) {
+      size_t original_size = 0;
+      size_t compressed_size = 0;
+      double compress_seconds = 0.0;
+      double decompress_seconds = 0.0;
+      for (const auto& r : results) {
+        if (r.config == config.name) {
+          original_size += r.original_size;
+          compressed_size += r.compressed_size;
+          compress_seconds += r.compress_seconds;
+          decompress_seconds += r.decompress_seconds;
+        }
+      }
+      if (original_size > 0) {
+        print_row("total", config.name, original_size, compressed_size,
+                  compress_seconds, decompress_seconds);
+      }
+    }
+
+    if (!json_filename.empty()) {
+      write_json(json_filename, results, warmup, repetitions);
+      std::cout << "Results written to: " << json_filename << std::endl;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file      delta_bench.cpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Microbenchmark of the scalar and vectorized delta transform
+ *
+ * @date      12 April  2025 \n
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "transformations.hpp"
+
+using kernel_t = void (*)(uint8_t*, size_t);
+
+// returns the best throughput in MB/s over the given number of repetitions
+double measure(kernel_t kernel, std::vector<uint8_t>& data, int repetitions) {
+  double best_seconds = 0.0;
+  for (int r = 0; r < repetitions; r++) {
+    auto start = std::chrono::steady_clock::now();
+    kernel(data.data(), data.size());
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    if (r == 0 || seconds < best_seconds) {
+      best_seconds = seconds;
+    }
+  }
+  return data.size() / best_seconds / 1e6;
+}
+
+int main(int argc, char* argv[]) {
+  size_t size = 64 << 20;
+  int repetitions = 20;
+  if (argc > 1) {
+    size = std::stoull(argv[1]);
+  }
+  if (argc > 2) {
+    repetitions = std::stoi(argv[2]);
+  }
+
+  std::vector<uint8_t> original(size);
+  std::mt19937 rng(42);
+  for (auto& byte : original) {
+    byte = static_cast<uint8_t>(rng());
+  }
+
+  // check the kernels against the scalar reference first
+  std::vector<uint8_t> reference = original;
+  std::vector<uint8_t> vectorized = original;
+  delta_encode_scalar(reference.data(), reference.size());
+  delta_encode(vectorized.data(), vectorized.size());
+  if (reference != vectorized) {
+    std::cerr << "Error: delta_encode does not match the scalar reference."
+              << std::endl;
+    return 1;
+  }
+  delta_decode(vectorized.data(), vectorized.size());
+  if (vectorized != original) {
+    std::cerr << "Error: delta_decode does not invert delta_encode."
+              << std::endl;
+    return 1;
+  }
+
+  std::vector<uint8_t> work = original;
+  std::cout << "Buffer: " << size << " bytes, best of " << repetitions
+            << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+  const std::vector<std::pair<std::string, kernel_t>> kernels = {
+      {"delta_encode_scalar", delta_encode_scalar},
+      {"delta_encode", delta_encode},
+      {"delta_decode_scalar", delta_decode_scalar},
+      {"delta_decode", delta_decode},
+  };
+  for (const auto& [name, kernel] : kernels) {
+    std::cout << std::left << std::setw(20) << name << " "
+              << measure(kernel, work, repetitions) << " MB/s" << std::endl;
+  }
+  return 0;
+}
@@ -14,6 +14,7 @@
 #include "argparser.hpp"
 
 #include <argparse.hpp>
+#include <cstdio>
 #include <iostream>
 
 #include "common.hpp"
@@ -32,14 +33,14 @@ ArgumentParser::ArgumentParser(int argc, char *argv[])
       .store_into(decompress_mode)
       .help("Decompress mode");
   program.add_argument("-i")
-      .required()
+      .default_value(std::string(""))
       .store_into(input_file)
-      .help("Input file")
+      .help("Input file, - for the standard input")
       .metavar("INPUT");
   program.add_argument("-o")
-      .required()
+      .default_value(std::string(""))
       .store_into(output_file)
-      .help("Output file")
+      .help("Output file, - for the standard output")
       .metavar("OUTPUT");
   program.add_argument("-a")
       .default_value(false)
@@ -51,6 +52,23 @@ ArgumentParser::ArgumentParser(int argc, char *argv[])
       .implicit_value(true)
       .store_into(model)
       .help("Use model preprocessing");
+  program.add_argument("-b")
+      .default_value(false)
+      .implicit_value(true)
+      .store_into(bwt)
+      .help("Use Burrows-Wheeler transform before the model");
+  program.add_argument("-s", "--stream")
+      .default_value(false)
+      .implicit_value(true)
+      .store_into(stream)
+      .help("Compress in bands of BLOCK_SIZE rows, implied by the - input");
+  program.add_argument("-e", "--entropy")
+      .default_value(std::string("huffman"))
+      .choices("raw", "huffman", "rans", "golomb")
+      .store_into(entropy)
+      .help("Coding of the token fields")
+      .nargs(1)
+      .metavar("MODE");
   program.add_argument("-w")
       .default_value<uint32_t>(1)
       .scan<'i', uint32_t>()
@@ -58,36 +76,72 @@ ArgumentParser::ArgumentParser(int argc, char *argv[])
       .help("Image width")
       .nargs(1)
       .metavar("WIDTH");
+  program.add_argument("-t", "--threads")
+      .default_value<uint32_t>(1)
+      .scan<'i', uint32_t>()
+      .store_into(threads)
+      .help("Number of threads decoding blocks or compressing a batch, 0 for "
+            "all hardware threads")
+      .nargs(1)
+      .metavar("THREADS");
+  program.add_argument("--batch")
+      .default_value(std::string(""))
+      .store_into(batch_file)
+      .help("Compress the files listed in MANIFEST, one INPUT OUTPUT WIDTH "
+            "per line")
+      .nargs(1)
+      .metavar("MANIFEST");
+  program.add_argument("--roi")
+      .store_into(roi)
+      .help("Decode only the rectangle of the image at X,Y of size W,H")
+      .nargs(1)
+      .metavar("X,Y,W,H");
   program.add_argument("--block_size")
       .default_value<uint16_t>(DEFAULT_BLOCK_SIZE)
       .scan<'i', uint16_t>()
-      .store_into(BLOCK_SIZE)
+      .store_into(params.block_size)
       .help("Block size (for adaptive mode)")
       .nargs(1)
       .metavar("BLOCK_SIZE");
   program.add_argument("--offset_bits")
       .default_value<uint32_t>(DEFAULT_OFFSET_BITS)
       .scan<'i', uint32_t>()
-      .store_into(OFFSET_BITS)
+      .store_into(params.offset_bits)
       .help("Number of bits used for offset in token")
       .nargs(1)
       .metavar("OFFSET_BITS");
   program.add_argument("--length_bits")
       .default_value<uint16_t>(DEFAULT_LENGTH_BITS)
       .scan<'i', uint16_t>()
-      .store_into(LENGTH_BITS)
+      .store_into(params.length_bits)
       .help("Number of bits used for length in token")
       .nargs(1)
       .metavar("LENGTH_BITS");
 
   try {
     program.parse_args(argc, argv);
+    // the standard output carries the data, messages go to the error output
+    if (output_file == "-") {
+      std::cout.rdbuf(std::cerr.rdbuf());
+    }
     if (!compress_mode && !decompress_mode) {
       throw std::runtime_error(
           "Error: Missing required argument '-c' or '-d' choosing compression "
           "or decompression respectively.");
     }
-    if (program.is_used("-a") && !program.is_used("-w")) {
+    if (is_batch()) {
+      if (!compress_mode || stream || program.is_used("-i") ||
+          program.is_used("-o")) {
+        throw std::runtime_error(
+            "Error: Batch mode only compresses the files of its manifest, "
+            "-d, -s, -i and -o cannot be used with --batch.");
+      }
+    } else if (input_file.empty() || output_file.empty()) {
+      throw std::runtime_error(
+          "Error: Missing required arguments '-i' and '-o' naming the input "
+          "and output files.");
+    }
+    if (!is_batch() && program.is_used("-a") && !program.is_used("-w")) {
       std::cout
           << "Warning: Adaptive mode with no width specified. Using default "
              "width of 1. Program may crash due to memory limits."
@@ -99,13 +153,34 @@ ArgumentParser::ArgumentParser(int argc, char *argv[])
                    "will be ignored."
                 << std::endl;
     }
+    if (compress_mode && !is_batch() && program.is_used("--threads")) {
+      std::cout << "Threads were specified but decompression mode is "
+                   "disabled. Ignoring."
+                << std::endl;
+    }
+    if (compress_mode && program.is_used("--roi")) {
+      std::cout << "Region was specified but decompression mode is "
+                   "disabled. Ignoring."
+                << std::endl;
+    } else if (program.is_used("--roi")) {
+      Region rectangle;
+      char trailing;
+      if (std::sscanf(roi.c_str(), "%u,%u,%u,%u%c", &rectangle.x,
+                      &rectangle.y, &rectangle.width, &rectangle.height,
+                      &trailing) != 4) {
+        throw std::runtime_error("Error: Invalid region '" + roi +
+                                 "', expected X,Y,W,H.");
+      }
+      region = rectangle;
+    }
     if (program.is_used("--block_size")) {
       if (compress_mode && !program.is_used("-a")) {
         std::cout << "Block size was specified but adaptive mode is disabled. "
                      "Ignoring."
                   << std::endl;
       } else if (compress_mode && program.is_used("-a")) {
-        std::cout << "Using block size of " << BLOCK_SIZE << std::endl;
+        std::cout << "Using block size of " << params.block_size
+                  << std::endl;
       } else {
         std::cout << "Block size was specified but compression mode is "
                      "disabled. Ignoring."
@@ -113,11 +188,11 @@ ArgumentParser::ArgumentParser(int argc, char *argv[])
       }
     }
     if (program.is_used("--offset_bits")) {
-      std::cout << "Using " << OFFSET_BITS << "b for offset in token"
+      std::cout << "Using " << params.offset_bits << "b for offset in token"
                 << std::endl;
     }
     if (program.is_used("--length_bits")) {
-      std::cout << "Using " << LENGTH_BITS << "b for length in token"
+      std::cout << "Using " << params.length_bits << "b for length in token"
                 << std::endl;
     }
     // print_args();
@@ -135,10 +210,19 @@ bool ArgumentParser::is_decompress_mode() const {
   return decompress_mode;
 }
 std::string ArgumentParser::get_input_file() const {
-  return input_file;
+  return input_file == "-" ? "/dev/stdin" : input_file;
 }
 std::string ArgumentParser::get_output_file() const {
-  return output_file;
+  return output_file == "-" ? "/dev/stdout" : output_file;
+}
+bool ArgumentParser::is_streaming() const {
+  return stream || input_file == "-";
+}
+bool ArgumentParser::is_batch() const {
+  return !batch_file.empty();
+}
+std::string ArgumentParser::get_batch_file() const {
+  return batch_file;
 }
 bool ArgumentParser::is_adaptive() const {
   return adaptive;
@@ -146,9 +230,30 @@ bool ArgumentParser::is_adaptive() const {
 bool ArgumentParser::use_model() const {
   return model;
 }
+bool ArgumentParser::use_bwt() const {
+  return bwt;
+}
+EntropyMode ArgumentParser::get_entropy_mode() const {
+  if (entropy == "raw") {
+    return ENTROPY_RAW;
+  }
+  if (entropy == "golomb") {
+    return ENTROPY_GOLOMB;
+  }
+  return entropy == "rans" ? ENTROPY_RANS : ENTROPY_HUFFMAN;
+}
 uint32_t ArgumentParser::get_image_width() const {
   return image_width;
 }
+uint32_t ArgumentParser::get_threads() const {
+  return threads;
+}
+std::optional<Region> ArgumentParser::get_region() const {
+  return region;
+}
+const CodecParams &ArgumentParser::get_params() const {
+  return params;
+}
 
 void ArgumentParser::print_args() const {
   compress_mode ? std::cout << "Compress mode" << std::endl
@@ -157,5 +262,11 @@ void ArgumentParser::print_args() const {
   std::cout << "Output file: " << output_file << std::endl;
   std::cout << "Adaptive strategy: " << adaptive << std::endl;
   std::cout << "Model preprocessing: " << model << std::endl;
+  std::cout << "Burrows-Wheeler transform: " << bwt << std::endl;
+  std::cout << "Streaming: " << is_streaming() << std::endl;
+  std::cout << "Entropy coding: " << entropy << std::endl;
   std::cout << "Image width: " << image_width << std::endl;
+  std::cout << "Threads: " << threads << std::endl;
+  std::cout << "Batch manifest: " << batch_file << std::endl;
+  std::cout << "Region: " << roi << std::endl;
 }
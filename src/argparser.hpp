@@ -15,8 +15,11 @@
 #define ARGUMENT_PARSER_H
 
 #include <argparse.hpp>
+#include <optional>
 #include <string>
 
+#include "common.hpp"
+
 /**
  * @class ArgumentParser
  * @brief Parses and stores command-line arguments for the lz_codec program.
@@ -30,7 +33,15 @@ class ArgumentParser {
   std::string output_file;
   bool adaptive;
   bool model;
+  bool bwt;
+  bool stream;
+  std::string entropy;
   uint32_t image_width;
+  uint32_t threads;
+  std::string batch_file;
+  std::string roi;
+  std::optional<Region> region;
+  CodecParams params;
 
   public:
   /**
@@ -54,16 +65,34 @@ class ArgumentParser {
 
   /**
    * @brief Gets the input file path.
-   * @return The input file path as a string.
+   * @return The input file path as a string, /dev/stdin for -.
    */
   std::string get_input_file() const;
 
   /**
    * @brief Gets the output file path.
-   * @return The output file path as a string.
+   * @return The output file path as a string, /dev/stdout for -.
    */
   std::string get_output_file() const;
 
+  /**
+   * @brief Checks if the input is compressed in bands of rows as a stream.
+   * @return True if -s was given or the input is the standard input.
+   */
+  bool is_streaming() const;
+
+  /**
+   * @brief Checks if the files of a manifest are compressed in a batch.
+   * @return True if --batch was given, false otherwise.
+   */
+  bool is_batch() const;
+
+  /**
+   * @brief Gets the manifest listing the files of a batch.
+   * @return The manifest path given by --batch.
+   */
+  std::string get_batch_file() const;
+
   /**
    * @brief Checks if the adaptive strategy is enabled.
    * @return True if adaptive strategy is enabled, false otherwise.
@@ -76,12 +105,44 @@ class ArgumentParser {
    */
   bool use_model() const;
 
+  /**
+   * @brief Checks if the Burrows-Wheeler transform is enabled.
+   * @return True if the BWT is applied before the model, false otherwise.
+   */
+  bool use_bwt() const;
+
+  /**
+   * @brief Gets the coding of the token fields.
+   * @return The entropy mode selected by the -e option.
+   */
+  EntropyMode get_entropy_mode() const;
+
   /**
    * @brief Gets the specified image width (used in model preprocessing).
    * @return The image width as a 32-bit unsigned integer.
    */
   uint32_t get_image_width() const;
 
+  /**
+   * @brief Gets the number of threads decoding the blocks of an image or
+   * compressing a batch.
+   * @return The thread count, 0 for one per hardware thread.
+   */
+  uint32_t get_threads() const;
+
+  /**
+   * @brief Gets the rectangle of the image to decode.
+   * @return The rectangle given by --roi, empty to decode the whole image.
+   */
+  std::optional<Region> get_region() const;
+
+  /**
+   * @brief Gets the token parameters and the block size to compress with.
+   * @return The parameters given by --offset_bits, --length_bits and
+   * --block_size.
+   */
+  const CodecParams &get_params() const;
+
   /**
    * @brief Prints the parsed arguments to standard output.
    */
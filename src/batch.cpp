@@ -0,0 +1,234 @@
+/**
+ * @file      batch.cpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Source file for the compression of a batch of files listed in a
+ * manifest
+ *
+ * @date      12 April  2025 \n
+ */
+
+#include "batch.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "image.hpp"
+#include "thread_pool.hpp"
+
+// a file listed in the manifest
+struct BatchEntry {
+  std::string input;
+  std::string output;
+  uint32_t width;
+};
+
+// options of the batch and the totals of its files, shared by all the tasks
+struct BatchState {
+  bool adaptive;
+  bool model;
+  bool bwt;
+  EntropyMode entropy_mode;
+  CodecParams params;
+  std::mutex mutex;  // guards the totals and the reports
+  size_t n_files = 0;
+  size_t n_failed = 0;
+  uint64_t original_size = 0;
+  uint64_t compressed_size = 0;
+};
+
+// a file being compressed, its blocks are encoded by separate tasks and the
+// last one to finish writes the file
+struct BatchJob {
+  BatchEntry entry;
+  uint64_t original_size = 0;
+  std::optional<Image> image;
+  std::atomic<size_t> remaining{0};
+  std::atomic<bool> failed{false};
+  std::string error;  // first error of the blocks, set under the state mutex
+};
+
+// reads the lines of the manifest, throws on a malformed one
+static std::vector<BatchEntry> read_manifest(const std::string& filename) {
+  std::ifstream manifest(filename);
+  if (!manifest) {
+    throw std::runtime_error("Error: Unable to open manifest: " + filename);
+  }
+  std::vector<BatchEntry> entries;
+  std::string line;
+  for (size_t line_number = 1; std::getline(manifest, line); line_number++) {
+    std::istringstream fields(line);
+    fields >> std::ws;
+    if (fields.eof() || fields.peek() == '#') {
+      continue;
+    }
+    BatchEntry entry;
+    fields >> std::quoted(entry.input) >> std::quoted(entry.output) >>
+        entry.width;
+    if (fields.fail() || !(fields >> std::ws).eof() || entry.width == 0) {
+      throw std::runtime_error("Error: Invalid manifest line " +
+                               std::to_string(line_number) +
+                               ", expected INPUT OUTPUT WIDTH.");
+    }
+    entries.push_back(std::move(entry));
+  }
+  return entries;
+}
+
+// records the outcome of a file, the written size or the error
+static void report(BatchState& state, const BatchEntry& entry,
+                   uint64_t original_size, uint64_t written_size,
+                   const std::string& error) {
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.n_files++;
+  if (!error.empty()) {
+    state.n_failed++;
+    std::cerr << entry.input << ": " << error << std::endl;
+    return;
+  }
+  state.original_size += original_size;
+  state.compressed_size += written_size;
+  std::cout << entry.input << " -> " << entry.output << ": " << original_size
+            << " -> " << written_size << " bytes" << std::endl;
+}
+
+// writes the encoded file, or the original data behind a zero byte if they
+// did not compress
+static void finish_file(BatchState& state, BatchJob& job) {
+  if (job.failed) {
+    report(state, job.entry, 0, 0, job.error);
+    job.image.reset();
+    return;
+  }
+  try {
+    job.image->release_input();
+    std::ofstream output(job.entry.output, std::ios::binary);
+    if (!output) {
+      throw std::runtime_error("Error: Unable to open output file: " +
+                               job.entry.output);
+    }
+    if (job.image->compressed_size() < job.original_size) {
+      job.image->write_blocks(output);
+    } else {
+      std::ifstream input(job.entry.input, std::ios::binary);
+      output.put(FORMAT_UNCOMPRESSED);
+      output << input.rdbuf();
+    }
+    uint64_t written_size = static_cast<uint64_t>(output.tellp());
+    if (!output.good()) {
+      throw std::runtime_error("Error: Failed to write " + job.entry.output +
+                               ".");
+    }
+    report(state, job.entry, job.original_size, written_size, "");
+  } catch (const std::exception& e) {
+    report(state, job.entry, 0, 0, e.what());
+  }
+  job.image.reset();
+}
+
+// maps a file and splits it into blocks, the blocks are queued in front of
+// the files not started yet, so only as many files are open as there are
+// threads taking their blocks
+static void start_file(ThreadPool& pool, BatchState& state,
+                       const BatchEntry& entry) {
+  auto job = std::make_shared<BatchJob>();
+  job->entry = entry;
+  try {
+    job->image.emplace(entry.input, entry.output, entry.width,
+                       state.adaptive, state.model, state.bwt,
+                       state.entropy_mode, state.params);
+    job->original_size = std::filesystem::file_size(entry.input);
+    if (job->original_size == 0) {
+      throw std::runtime_error("Error: Input file is empty.");
+    }
+    job->image->create_blocks();
+  } catch (const std::exception& e) {
+    report(state, entry, 0, 0, e.what());
+    return;
+  }
+
+  size_t n_blocks = job->image->m_blocks.size();
+  job->remaining = n_blocks;
+  if (n_blocks == 0) {
+    finish_file(state, *job);
+    return;
+  }
+  // queued from the last one, so the blocks are taken in order
+  for (size_t i = n_blocks; i-- > 0;) {
+    auto encode = [&state, job, i](WorkerContext& context) {
+      if (!job->failed) {
+        try {
+          job->image->encode_block(i, context.buffer);
+        } catch (const std::exception& e) {
+          std::lock_guard<std::mutex> lock(state.mutex);
+          if (!job->failed.exchange(true)) {
+            job->error = e.what();
+          }
+        }
+      }
+      if (--job->remaining == 0) {
+        finish_file(state, *job);
+      }
+    };
+    pool.submit(encode, true);
+  }
+}
+
+bool compress_batch(const std::string& manifest_filename, bool adaptive,
+                    bool model, bool bwt, EntropyMode entropy_mode,
+                    const CodecParams& params, unsigned threads) {
+  std::vector<BatchEntry> entries;
+  try {
+    entries = read_manifest(manifest_filename);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return false;
+  }
+
+  BatchState state;
+  state.adaptive = adaptive;
+  state.model = model;
+  state.bwt = bwt;
+  state.entropy_mode = entropy_mode;
+  state.params = params;
+
+  auto start = std::chrono::steady_clock::now();
+  unsigned n_threads;
+  {
+    ThreadPool pool(threads);
+    n_threads = pool.size();
+    for (const auto& entry : entries) {
+      pool.submit([&pool, &state, &entry](WorkerContext&) {
+        start_file(pool, state, entry);
+      });
+    }
+    pool.wait();
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  double throughput =
+      seconds > 0 ? state.original_size / seconds / (1 << 20) : 0.0;
+  std::cout << "Compressed " << state.n_files - state.n_failed << " of "
+            << state.n_files << " files with " << n_threads
+            << " threads: " << state.original_size << " -> "
+            << state.compressed_size << " bytes in " << std::fixed
+            << std::setprecision(3) << seconds << " s ("
+            << std::setprecision(2) << throughput << " MiB/s)" << std::endl;
+  return state.n_failed == 0;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file      batch.hpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Header file for the compression of a batch of files listed in a
+ * manifest
+ *
+ * @date      12 April  2025 \n
+ */
+
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <string>
+
+#include "common.hpp"
+
+/**
+ * @brief Compresses the files listed in a manifest, one file per line given
+ * by its input path, output path and width (paths containing spaces are
+ * quoted, empty lines and lines starting with # are skipped). The files and
+ * their blocks are encoded by one pool of threads, the size of every file
+ * and the total throughput are reported.
+ * @param manifest_filename Path to the manifest.
+ * @param adaptive Whether to use adaptive block strategy.
+ * @param model Whether to use model preprocessing (delta/MTF).
+ * @param bwt Whether to apply the Burrows-Wheeler transform before the model.
+ * @param entropy_mode Coding of the token fields.
+ * @param params Token parameters and the block size of adaptive mode.
+ * @param threads Number of threads, 0 for one per hardware thread.
+ * @return True if all the files were compressed, false otherwise.
+ */
+bool compress_batch(const std::string& manifest_filename, bool adaptive,
+                    bool model, bool bwt, EntropyMode entropy_mode,
+                    const CodecParams& params, unsigned threads);
+
+#endif  // BATCH_HPP
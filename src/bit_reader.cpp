@@ -0,0 +1,23 @@
+/**
+ * @file      bit_reader.cpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Source file for the MSB-first bit reader of the compressed
+ * stream
+ *
+ * @date      12 April  2025 \n
+ */
+
+#include "bit_reader.hpp"
+
+BitReader::BitReader(const uint8_t* data, size_t size)
+    : m_position(data),
+      m_end(data + size),
+      m_size(size),
+      m_consumed(0),
+      m_buffer(0),
+      m_bit_count(0) {}
@@ -0,0 +1,107 @@
+/**
+ * @file      bit_reader.hpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Header file for the MSB-first bit reader of the compressed
+ * stream
+ *
+ * @date      12 April  2025 \n
+ */
+
+#ifndef BIT_READER_HPP
+#define BIT_READER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// readable bytes the buffer of a BitReader must have past its end, the refill
+// always loads eight bytes
+#define BIT_READER_PADDING 8
+
+/**
+ * @class BitReader
+ * @brief Reads fields most significant bit first from a memory buffer
+ * through a 64-bit bit buffer. The refill is unconditional and never reads
+ * past the padding, reads past the end yield zeros and are reported by
+ * overrun(), so the decoding loops need no end of input checks.
+ */
+class BitReader {
+  public:
+  /**
+   * @brief Starts reading at the beginning of a buffer.
+   * @param data The buffer, followed by BIT_READER_PADDING readable bytes.
+   * @param size Size of the buffer without the padding.
+   */
+  BitReader(const uint8_t* data, size_t size);
+
+  /**
+   * @brief Tops the bit buffer up to at least 56 bits.
+   */
+  void refill() {
+    uint64_t word;
+    std::memcpy(&word, m_position, sizeof(word));
+    m_buffer |= __builtin_bswap64(word) >> m_bit_count;
+    // past the end the position stays at the padding, which reads as zeros
+    m_position = std::min(m_position + ((63 - m_bit_count) >> 3), m_end);
+    m_bit_count |= 56;
+  }
+
+  /**
+   * @brief Gets the next bits without consuming them, call refill() first.
+   * @param num_bits Number of bits, 0 to 32.
+   * @return The bits, the first one being the most significant.
+   */
+  uint32_t peek(int num_bits) const {
+    return static_cast<uint32_t>((m_buffer >> 1) >> (63 - num_bits));
+  }
+
+  /**
+   * @brief Drops bits returned by peek().
+   * @param num_bits Number of bits, at most the number peeked.
+   */
+  void consume(int num_bits) {
+    m_buffer <<= num_bits;
+    m_bit_count -= num_bits;
+    m_consumed += num_bits;
+  }
+
+  /**
+   * @brief Reads a field.
+   * @param num_bits Number of bits, 0 to 32.
+   * @return The field.
+   */
+  uint32_t read(int num_bits) {
+    refill();
+    uint32_t value = peek(num_bits);
+    consume(num_bits);
+    return value;
+  }
+
+  /**
+   * @brief Checks whether more bits were consumed than the buffer holds.
+   * @return True if the input ended prematurely.
+   */
+  bool overrun() const { return m_consumed > 8 * m_size; }
+
+  /**
+   * @brief Gets the number of bits consumed since the start.
+   * @return Number of consumed bits.
+   */
+  size_t bits_consumed() const { return m_consumed; }
+
+  private:
+  const uint8_t* m_position;  // next byte to load
+  const uint8_t* m_end;       // end of the data, the padding follows
+  size_t m_size;
+  size_t m_consumed;  // bits consumed since the start
+  uint64_t m_buffer;  // the next bit is the most significant one
+  int m_bit_count;    // valid bits of the buffer
+};
+
+#endif  // BIT_READER_HPP
@@ -0,0 +1,59 @@
+/**
+ * @file      bit_writer.cpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Source file for the buffered MSB-first bit writer of the
+ * compressed stream
+ *
+ * @date      12 April  2025 \n
+ */
+
+#include "bit_writer.hpp"
+
+BitWriter::BitWriter()
+    : m_accumulator(0), m_bit_count(0), m_flushed_bytes(0) {}
+
+void BitWriter::spill() {
+  m_bit_count -= 32;
+  uint32_t word = static_cast<uint32_t>(m_accumulator >> m_bit_count);
+  uint8_t bytes[4] = {
+      static_cast<uint8_t>(word >> 24), static_cast<uint8_t>(word >> 16),
+      static_cast<uint8_t>(word >> 8), static_cast<uint8_t>(word)};
+  m_buffer.insert(m_buffer.end(), bytes, bytes + 4);
+}
+
+void BitWriter::align() {
+  if (m_bit_count % 8 != 0) {
+    write(0, 8 - m_bit_count % 8);
+  }
+  // whole bytes left in the accumulator go to the buffer
+  while (m_bit_count > 0) {
+    m_bit_count -= 8;
+    m_buffer.push_back(static_cast<uint8_t>(m_accumulator >> m_bit_count));
+  }
+}
+
+size_t BitWriter::bits_written() const {
+  return 8 * (m_flushed_bytes + m_buffer.size()) + m_bit_count;
+}
+
+bool BitWriter::finish(std::ostream& stream) {
+  align();
+  stream.write(reinterpret_cast<const char*>(m_buffer.data()),
+               static_cast<std::streamsize>(m_buffer.size()));
+  m_flushed_bytes += m_buffer.size();
+  m_buffer.clear();
+  return stream.good();
+}
+
+std::vector<uint8_t> BitWriter::finish() {
+  align();
+  m_flushed_bytes += m_buffer.size();
+  std::vector<uint8_t> bytes;
+  bytes.swap(m_buffer);
+  return bytes;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file      bit_writer.hpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Header file for the buffered MSB-first bit writer of the
+ * compressed stream
+ *
+ * @date      12 April  2025 \n
+ */
+
+#ifndef BIT_WRITER_HPP
+#define BIT_WRITER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/**
+ * @class BitWriter
+ * @brief Packs fields most significant bit first into a 64-bit accumulator
+ * and appends whole words of it to an in-memory buffer. Every writer owns its
+ * state, so independent writers can be used from different threads.
+ */
+class BitWriter {
+  public:
+  BitWriter();
+
+  /**
+   * @brief Appends the low bits of a value.
+   * @param value The value, bits above num_bits are ignored.
+   * @param num_bits Number of bits to write, 0 to 32.
+   */
+  void write(uint32_t value, int num_bits) {
+    if (num_bits == 0) {
+      return;
+    }
+    m_accumulator = (m_accumulator << num_bits) |
+                    (value & (UINT64_MAX >> (64 - num_bits)));
+    m_bit_count += num_bits;
+    if (m_bit_count >= 32) {
+      spill();
+    }
+  }
+
+  /**
+   * @brief Appends a single bit.
+   * @param bit The bit.
+   */
+  void write_bit(bool bit) { write(bit, 1); }
+
+  /**
+   * @brief Pads the last byte with zero bits.
+   */
+  void align();
+
+  /**
+   * @brief Gets the number of bits written so far, including those already
+   * handed to a stream.
+   * @return Number of written bits.
+   */
+  size_t bits_written() const;
+
+  /**
+   * @brief Pads the last byte and hands everything buffered to a stream.
+   * @param stream The output stream.
+   * @return False if writing failed.
+   */
+  bool finish(std::ostream& stream);
+
+  /**
+   * @brief Pads the last byte and takes everything buffered.
+   * @return The buffered bytes, the writer is left empty.
+   */
+  std::vector<uint8_t> finish();
+
+  private:
+  // moves the top 32 accumulated bits to the buffer
+  void spill();
+
+  std::vector<uint8_t> m_buffer;
+  uint64_t m_accumulator;
+  int m_bit_count;         // valid low bits of the accumulator
+  size_t m_flushed_bytes;  // bytes already handed to a stream
+};
+
+#endif  // BIT_WRITER_HPP
@@ -15,6 +15,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <iterator>
 #include <map>
@@ -22,95 +23,284 @@
 #include <stdexcept>
 #include <vector>
 
+#include "block_writer.hpp"
 #include "common.hpp"
 #include "hashtable.hpp"
 #include "transformations.hpp"
 
-Block::Block(const std::vector<uint8_t> data, uint32_t width, uint32_t height)
-    : m_width(width), m_height(height), m_picked_strategy(HORIZONTAL) {
-  for (size_t i = 0; i < N_STRATEGIES; i++) {
-    m_data[i].reserve(width * height);
-  }
-  m_data[HORIZONTAL].assign(data.begin(), data.end());
-  m_strategy_results.fill({0, 0});
+// bytes past the end of the decoded data the match copies may overwrite
+static constexpr size_t WILD_COPY_SLACK = 32;
+
+Block::Block(const uint8_t* pixels, size_t stride, uint32_t width,
+             uint32_t height, const CodecParams& params)
+    : m_width(width),
+      m_height(height),
+      m_pixels(pixels),
+      m_stride(stride),
+      m_params(params),
+      m_picked_strategy(HORIZONTAL) {
+  m_strategy_results.fill({0, 0, 0});
 }
 
 Block::Block(uint32_t width, uint32_t height, SerializationStrategy strategy)
-    : m_width(width), m_height(height), m_picked_strategy(strategy) {
+    : m_width(width),
+      m_height(height),
+      m_pixels(nullptr),
+      m_stride(0),
+      m_picked_strategy(strategy) {
 }
 
-void Block::serialize_all_strategies() {
-  serialize(HORIZONTAL);
-  serialize(VERTICAL);
+uint32_t Block::row_stride(SerializationStrategy strategy) const {
+  // columns are serialized one after another in the vertical strategy
+  return strategy == VERTICAL ? m_height : m_width;
 }
 
-void Block::serialize(SerializationStrategy strategy) {
-  switch (strategy) {
-    case HORIZONTAL:
-      // default, does not need to be serialized
-      return;
-    case VERTICAL:
-      m_data[VERTICAL].clear();
-      m_data[VERTICAL].reserve(m_width * m_height);
-      for (size_t j = 0; j < m_width; ++j) {
-        for (size_t i = 0; i < m_height; ++i) {
-          m_data[VERTICAL].push_back(m_data[HORIZONTAL][i * m_width + j]);
-        }
+// models applied to the pixels in scan order when loading a block
+struct IdentityTransform {
+  uint8_t operator()(uint8_t value) { return value; }
+};
+
+struct DeltaTransform {
+  uint8_t last = 0;
+  uint8_t operator()(uint8_t value) {
+    uint8_t delta = static_cast<uint8_t>(value - last);
+    last = value;
+    return delta;
+  }
+};
+
+struct MtfTransform {
+  uint8_t dictionary[256];
+  MtfTransform() {
+    std::iota(std::begin(dictionary), std::end(dictionary), 0);
+  }
+  uint8_t operator()(uint8_t value) {
+    if (dictionary[0] == value) {
+      return 0;
+    }
+    const uint8_t* found = static_cast<const uint8_t*>(
+        std::memchr(dictionary, value, sizeof(dictionary)));
+    uint8_t index = static_cast<uint8_t>(found - dictionary);
+    std::memmove(dictionary + 1, dictionary, index);
+    dictionary[0] = value;
+    return index;
+  }
+};
+
+// reads the pixels in scan order through the model, rows one after another
+// for the horizontal strategy and columns for the vertical one
+template <typename Transform>
+static void scan_pixels(Transform& transform, const uint8_t* pixels,
+                        size_t stride, uint32_t width, uint32_t height,
+                        bool vertical, uint8_t* out) {
+  if (!vertical) {
+    for (uint32_t r = 0; r < height; r++) {
+      const uint8_t* row = pixels + r * stride;
+      for (uint32_t c = 0; c < width; c++) {
+        *out++ = transform(row[c]);
       }
-      break;
-    default:
-      break;
+    }
+  } else {
+    for (uint32_t c = 0; c < width; c++) {
+      const uint8_t* column = pixels + c;
+      for (uint32_t r = 0; r < height; r++) {
+        *out++ = transform(column[r * stride]);
+      }
+    }
   }
 }
 
-void Block::deserialize() {
-  const SerializationStrategy strategy = m_picked_strategy;
-  if (strategy == HORIZONTAL) {
-    return;
+void Block::load(SerializationStrategy strategy, bool model,
+                 std::vector<uint8_t> buffer) {
+  buffer.resize(static_cast<size_t>(m_width) * m_height);
+  bool vertical = strategy == VERTICAL;
+  if (!model) {
+    IdentityTransform identity;
+    scan_pixels(identity, m_pixels, m_stride, m_width, m_height, vertical,
+                buffer.data());
+  } else {
+#if MTF
+    MtfTransform transform;
+#else
+    DeltaTransform transform;
+#endif
+    scan_pixels(transform, m_pixels, m_stride, m_width, m_height, vertical,
+                buffer.data());
+  }
+  m_data[strategy] = std::move(buffer);
+}
+
+void Block::encode(SerializationStrategy strategy, bool model, bool bwt,
+                   std::vector<uint8_t>& buffer) {
+  // the BWT of the scanned block comes before the model
+  load(strategy, model && !bwt, std::move(buffer));
+  if (bwt) {
+    Block::bwt(strategy);
+    if (model) {
+#if MTF
+      mtf(strategy);
+#else
+      delta_transform(strategy);
+#endif
+    }
+  }
+  encode_using_strategy(strategy);
+#if !DEBUG_COMP_ENC_UNENC
+  // the data are only needed to compare them with the decoded ones
+  buffer = std::move(m_data[strategy]);
+#endif
+}
+
+// inverse models applied to the decoded bytes in serialized order, span
+// writes the reversed bytes out step bytes apart, skip only advances the
+// state
+struct IdentityModel {
+  void span(const uint8_t* in, uint32_t n, uint8_t* out, size_t step) {
+    if (step == 1) {
+      std::memcpy(out, in, n);
+      return;
+    }
+    for (uint32_t i = 0; i < n; i++, out += step) {
+      *out = in[i];
+    }
   }
+  void skip(const uint8_t*, uint32_t) {}
+};
 
-  m_decoded_deserialized_data.clear();
-  m_decoded_deserialized_data.resize(m_width * m_height);
+struct DeltaModel {
+  uint8_t last = 0;
+  void span(const uint8_t* in, uint32_t n, uint8_t* out, size_t step) {
+    for (uint32_t i = 0; i < n; i++, out += step) {
+      last = static_cast<uint8_t>(last + in[i]);
+      *out = last;
+    }
+  }
+  void skip(const uint8_t* in, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+      last = static_cast<uint8_t>(last + in[i]);
+    }
+  }
+};
 
-  for (size_t i = 0; i < m_height; ++i) {
-    size_t dest_index_no_j = i * m_width;
-    for (size_t j = 0; j < m_width; ++j) {
-      size_t src_index = j * m_height + i;
-      if (src_index >= m_decoded_data.size()) {
-        throw std::runtime_error(
-            "Deserialize error: Source index out of bounds.");
+struct MtfModel {
+  uint8_t dictionary[256];
+  MtfModel() { std::iota(std::begin(dictionary), std::end(dictionary), 0); }
+  uint8_t get(uint8_t index) {
+    uint8_t value = dictionary[index];
+    // mostly small indices, shifted in place
+    if (index < 16) {
+      for (uint32_t i = index; i > 0; i--) {
+        dictionary[i] = dictionary[i - 1];
       }
+    } else {
+      std::memmove(dictionary + 1, dictionary, index);
+    }
+    dictionary[0] = value;
+    return value;
+  }
+  void span(const uint8_t* in, uint32_t n, uint8_t* out, size_t step) {
+    for (uint32_t i = 0; i < n;) {
+      if (in[i] != 0) {
+        *out = get(in[i]);
+        out += step;
+        i++;
+        continue;
+      }
+      // runs of index 0 repeat the front of the dictionary
+      uint32_t run = static_cast<uint32_t>(run_length(in + i, n - i));
+      if (step == 1) {
+        std::memset(out, dictionary[0], run);
+        out += run;
+      } else {
+        for (uint32_t j = 0; j < run; j++, out += step) {
+          *out = dictionary[0];
+        }
+      }
+      i += run;
+    }
+  }
+  void skip(const uint8_t* in, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+      if (in[i] != 0) {
+        get(in[i]);
+      }
+    }
+  }
+};
+
+// passes a serialized line through the model, the bytes from begin to end
+// are written out step bytes apart
+template <typename Model>
+static void place_line(Model& model, const uint8_t* line, uint32_t length,
+                       uint32_t begin, uint32_t end, uint8_t* out,
+                       size_t step) {
+  model.skip(line, begin);
+  model.span(line + begin, end - begin, out, step);
+  model.skip(line + end, length - end);
+}
 
-      m_decoded_deserialized_data[dest_index_no_j + j] =
-          m_decoded_data[src_index];
+// rows are serialized one after another in the horizontal strategy, columns
+// in the vertical one, the model state runs through the whole block
+template <typename Model>
+static void place_lines(Model& model, const uint8_t* source, uint32_t width,
+                        uint32_t height, bool vertical, const Region& window,
+                        uint8_t* destination, size_t stride) {
+  if (!vertical) {
+    for (uint32_t r = 0; r < height; r++) {
+      const uint8_t* line = source + static_cast<size_t>(r) * width;
+      if (r < window.y || r >= window.y + window.height) {
+        place_line(model, line, width, 0, 0, destination, 1);
+      } else {
+        place_line(model, line, width, window.x, window.x + window.width,
+                   destination + (r - window.y) * stride, 1);
+      }
+    }
+  } else {
+    for (uint32_t c = 0; c < width; c++) {
+      const uint8_t* line = source + static_cast<size_t>(c) * height;
+      if (c < window.x || c >= window.x + window.width) {
+        place_line(model, line, height, 0, 0, destination, stride);
+      } else {
+        place_line(model, line, height, window.y, window.y + window.height,
+                   destination + (c - window.x), stride);
+      }
     }
   }
-  m_decoded_data.clear();
-  m_decoded_data.shrink_to_fit();
 }
 
-void Block::delta_transform(SerializationStrategy strategy) {
-  if (m_data.empty()) {
+void Block::place_decoded(bool model, const Region& window,
+                          uint8_t* destination, size_t stride) const {
+  const uint8_t* source = m_decoded_data.data();
+  bool vertical = m_picked_strategy == VERTICAL;
+  if (!model) {
+    IdentityModel identity;
+    place_lines(identity, source, m_width, m_height, vertical, window,
+                destination, stride);
     return;
   }
-  uint8_t prev_original = m_data[strategy][0];
-  for (uint64_t i = 1; i < m_data[strategy].size(); i++) {
-    uint8_t current_original = m_data[strategy][i];
-    m_data[strategy][i] =
-        static_cast<uint8_t>(current_original - prev_original);
-    prev_original = current_original;
-  }
+#if MTF
+  MtfModel inverse;
+#else
+  DeltaModel inverse;
+#endif
+  place_lines(inverse, source, m_width, m_height, vertical, window,
+              destination, stride);
 }
+
+void Block::bwt(SerializationStrategy strategy) {
+  m_bwt_rows[strategy] = bwt_transform(m_data[strategy]);
+}
+
+void Block::reverse_bwt() {
+  reverse_bwt_transform(m_decoded_data, m_bwt_rows[m_picked_strategy]);
+}
+
+void Block::delta_transform(SerializationStrategy strategy) {
+  delta_encode(m_data[strategy].data(), m_data[strategy].size());
+}
+
 void Block::reverse_delta_transform() {
-  if (m_decoded_data.empty()) {
-    return;
-  }
-  uint8_t prev_reconstructed = m_decoded_data[0];
-  for (uint64_t i = 1; i < m_decoded_data.size(); i++) {
-    m_decoded_data[i] =
-        static_cast<uint8_t>(m_decoded_data[i] + prev_reconstructed);
-    prev_reconstructed = m_decoded_data[i];
-  }
+  delta_decode(m_decoded_data.data(), m_decoded_data.size());
 }
 
 void Block::mtf(SerializationStrategy strategy) {
@@ -140,6 +330,37 @@ void Block::insert_token(SerializationStrategy strategy, token_t token) {
   // add to the strategy result for picking the best one in adaptive
   token.coded ? m_strategy_results[strategy].n_coded_tokens++
               : m_strategy_results[strategy].n_unencoded_tokens++;
+  m_strategy_results[strategy].n_token_bits +=
+      token_size_bits(token, m_params);
+}
+
+// copies a match of the given length from offset bytes back, up to
+// WILD_COPY_SLACK bytes past its end may be overwritten
+static void copy_match(uint8_t* dst, size_t offset, size_t length) {
+  const uint8_t* src = dst - offset;
+  if (offset == 1) {
+    // run of the previous byte
+    std::memset(dst, *src, length);
+  } else if (offset >= 32) {
+    for (size_t i = 0; i < length; i += 32) {
+      std::memcpy(dst + i, src + i, 32);
+    }
+  } else if (offset >= 16) {
+    for (size_t i = 0; i < length; i += 16) {
+      std::memcpy(dst + i, src + i, 16);
+    }
+  } else {
+    // repeat the period in a 16 byte pattern written in steps of whole
+    // periods
+    uint8_t pattern[16];
+    for (size_t i = 0; i < sizeof(pattern); i++) {
+      pattern[i] = src[i % offset];
+    }
+    size_t step = sizeof(pattern) - sizeof(pattern) % offset;
+    for (size_t i = 0; i < length; i += step) {
+      std::memcpy(dst + i, pattern, sizeof(pattern));
+    }
+  }
 }
 
 void Block::decode_using_strategy(SerializationStrategy strategy) {
@@ -147,42 +368,42 @@ void Block::decode_using_strategy(SerializationStrategy strategy) {
     strategy = m_picked_strategy;
   }
   auto& tokens = m_tokens[strategy];
-  uint64_t position = 0;
-  m_decoded_data.reserve(m_width * m_height);
-  for (size_t i = 0; i < tokens.size(); i++) {
-    token_t token = tokens[i];
+
+  // the output is sized for the whole block up front, the slack absorbs the
+  // overshoot of the wild copies so only tokens are bounds checked
+  size_t size = static_cast<size_t>(m_width) * m_height;
+  m_decoded_data.resize(size + WILD_COPY_SLACK);
+  uint8_t* output = m_decoded_data.data();
+  size_t position = 0;
+  for (const token_t& token : tokens) {
     if (token.coded) {
       // coded token
-      uint64_t token_position = position - token.data.offset;
-      uint16_t length = token.data.length + MIN_CODED_LEN;
-      for (uint16_t j = 0; j < length; j++) {
-        m_decoded_data.push_back(m_decoded_data[token_position + j]);
+      size_t offset = token.data.offset;
+      size_t length = token.data.length + MIN_CODED_LEN;
+      if (offset == 0 || offset > position || length > size - position) {
+        throw std::runtime_error(
+            "Error: Coded token out of the bounds of the decoded block.");
       }
+      copy_match(output + position, offset, length);
 #if DEBUG_PRINT
-      std::cout << "decoded: " << static_cast<int>(token.data.offset) << " "
-                << static_cast<int>(token.data.length) << std::endl;
-      std::cout << "decoded: ";
-      for (uint16_t j = token_position; j < token_position + length; j++) {
-        std::cout << static_cast<int>(m_decoded_data[j]) << " ";
-      }
-      std::cout << "(";
-      for (uint16_t j = 0; j < length; j++) {
-        std::cout << static_cast<char>(m_decoded_data[j]);
-      }
-      std::cout << ")" << std::endl;
+      std::cout << "decoded: " << offset << " " << length << std::endl;
 #endif
       position += length;
 
     } else {
       // uncoded token
-      m_decoded_data.push_back(token.data.value);
+      if (position == size) {
+        throw std::runtime_error(
+            "Error: Uncoded token out of the bounds of the decoded block.");
+      }
+      output[position++] = token.data.value;
 #if DEBUG_PRINT
       std::cout << "decoded: " << static_cast<int>(token.data.value) << "("
                 << static_cast<char>(token.data.value) << ")" << std::endl;
 #endif
-      position++;
     }
   }
+  m_decoded_data.resize(position);
 #if DEBUG_PRINT
   std::cout << "decoded data: ";
   for (size_t i = 0; i < m_decoded_data.size(); i++) {
@@ -195,7 +416,18 @@ void Block::decode_using_strategy(SerializationStrategy strategy) {
   }
   std::cout << std::endl;
 #endif
-  reverse_rle(m_decoded_data);
+}
+
+// positions inside a run (repeating the previous byte and followed by more
+// of it) only ever match other runs, which are coded by run tokens, so they
+// are kept out of the hash table
+static bool is_run_interior(const std::vector<uint8_t>& data,
+                            uint64_t position) {
+  if (position == 0 || position + MIN_CODED_LEN >= data.size()) {
+    return false;
+  }
+  return run_length(&data[position - 1], MIN_CODED_LEN + 2) ==
+         MIN_CODED_LEN + 2;
 }
 
 void Block::encode_using_strategy(SerializationStrategy strategy) {
@@ -204,7 +436,7 @@ void Block::encode_using_strategy(SerializationStrategy strategy) {
     strategy = HORIZONTAL;
   }
 
-  auto hash_table = HashTable(HASH_TABLE_SIZE);
+  auto hash_table = HashTable(HASH_TABLE_SIZE, m_params);
   // push the first two bytes unencoded since the dict is empty
   uint64_t position = 0;
   for (position = 0; position < MIN_CODED_LEN; position++) {
@@ -212,43 +444,68 @@ void Block::encode_using_strategy(SerializationStrategy strategy) {
                             .data = {.value = m_data[strategy][position]}});
   }
 
-  rle(m_data[strategy]);
-
+  const std::vector<uint8_t>& data = m_data[strategy];
   hash_table.insert(m_data[strategy], 0);
   uint64_t next_pos;
   uint64_t removed_until = 0;
+  uint32_t search_buf_size = m_params.search_buf_size();
+  RepOffsets reps;
   // iterate over all bytes of the input
   for (position = MIN_CODED_LEN, next_pos = MIN_CODED_LEN;
-       position < m_data[strategy].size();) {
-    // search for the longest prefix in the hash table
-    search_result result = hash_table.search(m_data[strategy], position);
+       position < data.size();) {
+    // bytes repeating the previous one form a run, coded as an offset 1 match
+    size_t run = run_length(&data[position - 1],
+                            std::min<size_t>(data.size() - position + 1,
+                                             MAX_RUN_LEN + 1)) -
+                 1;
+    bool use_run = run >= MIN_CODED_LEN;
+    search_result result{false, 0, 0};
+    // no match can be longer than a run reaching the maximum coded length
+    if (run < m_params.max_coded_len()) {
+      // search for the longest prefix in the hash table
+      result = hash_table.search(m_data[strategy], position, reps,
+                                 row_stride(strategy));
+      use_run = use_run &&
+                (!result.found ||
+                 run >= static_cast<size_t>(result.length) + MIN_CODED_LEN);
+    }
     next_pos = position + result.length;
 
-    if (result.found) {
+    if (use_run) {
+      insert_token(strategy,
+                   {.coded = true,
+                    .data = {.offset = 1,
+                             .length = static_cast<uint16_t>(
+                                 run - MIN_CODED_LEN)}});
+      reps.update(1);
+      next_pos = position + run;
+    } else if (result.found) {
       next_pos += MIN_CODED_LEN;
       // found a match, push the token
-      insert_token(
-          strategy,
-          {.coded = true,
-           .data = {.offset = static_cast<uint16_t>(position - result.position),
-                    .length = result.length}});
+      uint16_t offset = static_cast<uint16_t>(position - result.position);
+      insert_token(strategy, {.coded = true,
+                              .data = {.offset = offset,
+                                       .length = result.length}});
+      reps.update(offset);
     } else {
       // no match found, push the byte unencoded
-      insert_token(strategy, {.coded = false,
-                              .data = {.value = m_data[strategy][position]}});
+      insert_token(strategy,
+                   {.coded = false, .data = {.value = data[position]}});
       next_pos++;
     }
 
     // insert new prefixes into the hash table
     while (position < next_pos) {
-      hash_table.insert(m_data[strategy], position - MIN_CODED_LEN + 1);
+      if (!is_run_interior(data, position - MIN_CODED_LEN + 1)) {
+        hash_table.insert(m_data[strategy], position - MIN_CODED_LEN + 1);
+      }
       position++;
     }
 
     // remove old entries from the hash table
-    if (position > SEARCH_BUF_SIZE) {
+    if (position > search_buf_size) {
       size_t remove_from = removed_until;
-      size_t remove_to = position - SEARCH_BUF_SIZE - 1;
+      size_t remove_to = position - search_buf_size - 1;
       for (size_t r = remove_from; r <= remove_to; r++) {
         hash_table.remove(m_data[strategy], r);
       }
@@ -257,14 +514,16 @@ void Block::encode_using_strategy(SerializationStrategy strategy) {
   }
 }
 
-void Block::encode_adaptive() {
+void Block::encode_adaptive(EntropyMode entropy_mode, bool model, bool bwt,
+                            std::vector<uint8_t>& buffer) {
   size_t best_encoded_size = 0, current_strategy_result;
   bool first = true;
   for (size_t i = HORIZONTAL; i < N_STRATEGIES; i++) {
-    encode_using_strategy(static_cast<SerializationStrategy>(i));
-    current_strategy_result =
-        m_strategy_results[i].n_coded_tokens * TOKEN_CODED_LEN +
-        m_strategy_results[i].n_unencoded_tokens * TOKEN_UNCODED_LEN;
+    encode(static_cast<SerializationStrategy>(i), model, bwt, buffer);
+    // exact size in the selected coding, tables and BWT rows included
+    current_strategy_result = block_payload_bits(m_tokens[i], row_stride(i),
+                                                 entropy_mode, m_params) +
+                              32 * m_bwt_rows[i].size();
     if (first || current_strategy_result < best_encoded_size) {
       best_encoded_size = current_strategy_result;
       m_picked_strategy = static_cast<SerializationStrategy>(i);
@@ -29,12 +29,17 @@
 class Block {
   public:
   /**
-   * @brief Constructor for encoding. Initializes a block with data.
-   * @param data The raw data for the block.
+   * @brief Constructor for encoding. The block is a view of the image, its
+   * pixels are read when a strategy is encoded.
+   * @param pixels The first pixel of the block in the image, it must stay
+   * valid until the block is encoded.
+   * @param stride Distance between the rows of the image.
    * @param width The width of the block (relevant for image data).
    * @param height The height of the block (relevant for image data).
+   * @param params Token parameters the block is encoded with.
    */
-  Block(const std::vector<uint8_t> data, uint32_t width, uint32_t height);
+  Block(const uint8_t* pixels, size_t stride, uint32_t width,
+        uint32_t height, const CodecParams& params);
 
   /**
    * @brief Constructor for decoding. Initializes an empty block with dimensions
@@ -46,21 +51,58 @@ class Block {
   Block(uint32_t width, uint32_t height, SerializationStrategy strategy);
 
   /**
-   * @brief Applies serialization transformations for all supported strategies.
+   * @brief Gets the distance between a byte and the byte above it in the
+   * serialized data.
+   * @param strategy The serialization strategy.
+   * @return Width of the block for horizontal, height for vertical.
    */
-  void serialize_all_strategies();
+  uint32_t row_stride(SerializationStrategy strategy) const;
 
   /**
-   * @brief Applies a specific serialization transformation (e.g., vertical
-   * scan) to the block's data.
-   * @param strategy The serialization strategy to apply.
+   * @brief Reads the pixels of the block in the scan order of a strategy
+   * (rows or columns) into its data, applying the model in the same pass.
+   * @param strategy The serialization strategy.
+   * @param model Whether the model is applied on the way.
+   * @param buffer Storage reused for the data.
    */
-  void serialize(SerializationStrategy strategy);
+  void load(SerializationStrategy strategy, bool model,
+            std::vector<uint8_t> buffer);
 
   /**
-   * @brief Reverses the serialization transformation applied during encoding.
+   * @brief Loads, transforms and encodes the block in one strategy, then
+   * hands the storage of its data back.
+   * @param strategy The serialization strategy to encode.
+   * @param model Whether model preprocessing is used.
+   * @param bwt Whether the Burrows-Wheeler transform precedes the model.
+   * @param buffer Storage reused for the data of the strategy.
    */
-  void deserialize();
+  void encode(SerializationStrategy strategy, bool model, bool bwt,
+              std::vector<uint8_t>& buffer);
+
+  /**
+   * @brief Writes the decoded data to its place in an image, reversing the
+   * model and the serialization in the same pass.
+   * @param model Whether the model is reversed on the way.
+   * @param window Rows and columns of the block to write, in block
+   * coordinates.
+   * @param destination Pixel of the image receiving the first row and column
+   * of the window.
+   * @param stride Distance between the rows of the image.
+   */
+  void place_decoded(bool model, const Region& window, uint8_t* destination,
+                     size_t stride) const;
+
+  /**
+   * @brief Applies the Burrows-Wheeler transform to the data for a specific
+   * strategy and stores the rows needed to reverse it.
+   * @param strategy The serialization strategy whose data to transform.
+   */
+  void bwt(SerializationStrategy strategy);
+
+  /**
+   * @brief Reverses the Burrows-Wheeler transform applied during encoding.
+   */
+  void reverse_bwt();
 
   /**
    * @brief Applies delta transformation (difference coding) to the data for a
@@ -113,8 +155,13 @@ class Block {
   /**
    * @brief Encodes the block using all strategies and picks the one resulting
    * in the smallest encoded size.
+   * @param entropy_mode Coding of the token fields the sizes are measured in.
+   * @param model Whether model preprocessing is used.
+   * @param bwt Whether the Burrows-Wheeler transform precedes the model.
+   * @param buffer Storage reused for the data of every strategy.
    */
-  void encode_adaptive();
+  void encode_adaptive(EntropyMode entropy_mode, bool model, bool bwt,
+                       std::vector<uint8_t>& buffer);
 
   /**
    * @brief Compares the original data (for the picked strategy) with the
@@ -135,21 +182,6 @@ class Block {
    */
   std::vector<uint8_t>& get_data();
 
-  /**
-   * @brief Gets a constant reference to the decoded data vector.
-   * @return A constant reference to the decoded data (potentially after
-   * deserialization).
-   */
-  const std::vector<uint8_t>& get_decoded_data() {
-    // If deserialization happened (strategy wasn't HORIZONTAL), return the
-    // deserialized data. Otherwise, return the directly decoded data.
-    if (m_picked_strategy != HORIZONTAL &&
-        !m_decoded_deserialized_data.empty()) {
-      return m_decoded_deserialized_data;
-    }
-    return m_decoded_data;
-  }
-
   public:
   // Internal data storage for different serialization strategies
   std::array<std::vector<uint8_t>, N_STRATEGIES> m_data;
@@ -159,13 +191,19 @@ class Block {
   std::array<StrategyResult, N_STRATEGIES> m_strategy_results;
   // Parameters for delta transformation (if used)
   std::array<uint8_t, N_STRATEGIES> m_delta_params;
+  // Start rows of the inverse BWT chains (if the BWT is used)
+  std::array<std::vector<uint32_t>, N_STRATEGIES> m_bwt_rows;
   // Block dimensions
   uint32_t m_width;
   uint32_t m_height;
-  // Data buffer used during decoding before potential deserialization
+  // First pixel of the block in the image and the image row stride, read
+  // when encoding
+  const uint8_t* m_pixels;
+  size_t m_stride;
+  // Token parameters used when encoding
+  CodecParams m_params;
+  // Data buffer used during decoding, in serialized order
   std::vector<uint8_t> m_decoded_data;
-  // Data buffer used after deserialization during decoding
-  std::vector<uint8_t> m_decoded_deserialized_data;
   // The serialization strategy chosen (either fixed or adaptively determined)
   SerializationStrategy m_picked_strategy;
 };
@@ -11,234 +11,737 @@
  * @date      12 April  2025 \n
  */
 
-#include <fstream>
+#include "block_reader.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <istream>
+#include <string>
 #include <vector>
 
+#include "bit_reader.hpp"
 #include "block.hpp"
+#include "huffman.hpp"
+#include "mapped_file.hpp"
+#include "range_coder.hpp"
+#include "rans.hpp"
 #include "token.hpp"
+#include "transformations.hpp"
+
+// format, version, width, height, offset bits and length bits stored natively
+static constexpr size_t NATIVE_HEADER_SIZE =
+    2 * sizeof(uint8_t) + 3 * sizeof(uint32_t) + sizeof(uint16_t);
+// number of blocks, then the offset and size of every block
+static constexpr size_t SEEK_TABLE_ENTRY_SIZE = 2 * sizeof(uint64_t);
+
+// the helpers below report a premature end of the input, the token loops
+// check it once per block instead
+static bool read_bit(BitReader& reader, bool& bit) {
+  bit = reader.read(1);
+  return !reader.overrun();
+}
 
-// internal state for bit reading
-uint8_t reader_buffer = 0;
-int reader_bit_position = 8;
-bool reader_eof = false;
-
-// resets the internal state of the bit reader
-void reset_bit_reader_state() {
-  reader_buffer = 0;
-  reader_bit_position = 8;
-  reader_eof = false;
+static bool read_bits(BitReader& reader, int num_bits, uint32_t& value) {
+  value = reader.read(num_bits);
+  return !reader.overrun();
 }
 
-bool read_bit_from_file(std::ifstream& file, bool& bitValue) {
-  if (reader_eof) {
-    return false;
-  }
+// decodes one symbol of a Huffman code from the stream
+static bool read_symbol(BitReader& reader, const HuffmanTable& table,
+                        uint16_t& symbol) {
+  reader.refill();
+  int length = static_cast<int>(
+      table.decode(reader.peek(HUFFMAN_MAX_CODE_LEN), symbol));
+  reader.consume(length);
+  return length != 0;
+}
 
-  if (reader_bit_position == 8) {
-    if (!file.read(reinterpret_cast<char*>(&reader_buffer), 1)) {
-      reader_eof = file.eof();
+// reads code lengths stored by the writer, a zero is followed by the number
+// of zeros after it
+static bool read_code_lengths(BitReader& reader, size_t n_symbols,
+                              std::vector<uint8_t>& lengths) {
+  lengths.assign(n_symbols, 0);
+  for (size_t i = 0; i < n_symbols;) {
+    uint32_t length;
+    if (!read_bits(reader, 4, length)) {
       return false;
     }
-    reader_bit_position = 0;
+    if (length != 0) {
+      lengths[i++] = static_cast<uint8_t>(length);
+      continue;
+    }
+    uint32_t run;
+    if (!read_bits(reader, 6, run)) {
+      return false;
+    }
+    if (i + run + 1 > n_symbols) {
+      throw std::runtime_error("Huffman Error: Code length run out of range.");
+    }
+    i += run + 1;
+  }
+  return true;
+}
+
+// offset of a row or rep symbol, corrupted input may refer to a rep slot
+// not filled yet or to a row offset out of range
+static uint32_t implicit_offset(uint32_t symbol, const RepOffsets& reps,
+                                uint32_t row_stride) {
+  if (symbol >= OFFSET_SYMBOLS) {
+    throw std::runtime_error("Invalid row offset.");
   }
+  uint32_t offset = symbol >= ROW_SYMBOL_BASE
+                        ? row_stride - 1 + (symbol - ROW_SYMBOL_BASE)
+                        : reps[symbol - REP_SYMBOL_BASE];
+  if (offset == 0 || offset > UINT16_MAX) {
+    throw std::runtime_error("Invalid rep or row offset.");
+  }
+  return offset;
+}
 
-  // extract the bit
-  bitValue = (reader_buffer >> (7 - reader_bit_position)) & 1;
-  reader_bit_position++;
+// resolves an offset symbol, a row offset, a rep slot or a log2 bucket
+// followed by its extra bits
+static uint32_t read_offset(BitReader& reader, uint32_t symbol,
+                            const RepOffsets& reps, uint32_t row_stride) {
+  if (symbol >= OFFSET_BUCKETS) {
+    return implicit_offset(symbol, reps, row_stride);
+  }
+  return log2_bucket_base(symbol) +
+         reader.read(log2_bucket_extra_bits(symbol));
+}
 
-  return true;
+// decodes a value coded most significant bit first as a binary tree of
+// adaptive probabilities
+template <typename Probability>
+static uint32_t decode_tree(BinaryRangeDecoder& decoder, int n_bits,
+                            Probability probability) {
+  size_t node = 1;
+  for (int bit = 0; bit < n_bits; bit++) {
+    node = 2 * node + decoder.decode(probability(node));
+  }
+  return static_cast<uint32_t>(node - (size_t{1} << n_bits));
 }
 
-bool read_bits_from_file(std::ifstream& file, int num_bits, uint32_t& value) {
-  if (num_bits < 0 || num_bits > 32) {
-    throw std::out_of_range("Number of bits must be between 0 and 32.");
+// decodes whether a coded token copies from the previous row or uses a rep
+// slot, returns its offset symbol or 0 if the offset is explicit
+static uint32_t decode_offset_symbol(BinaryRangeDecoder& decoder,
+                                     FlagModel& model) {
+  if (decoder.decode(model.row_probability())) {
+    return ROW_SYMBOL_BASE +
+           decode_tree(decoder, ROW_INDEX_BITS, [&](size_t node) -> uint16_t& {
+             return model.row_index_probability(node);
+           });
   }
-  if (reader_eof)
+  if (decoder.decode(model.rep_probability())) {
+    return REP_SYMBOL_BASE +
+           decode_tree(decoder, REP_SLOT_BITS, [&](size_t node) -> uint16_t& {
+             return model.slot_probability(node);
+           });
+  }
+  return 0;
+}
+
+// reads the code tables of a block and decodes its tokens
+static bool read_huffman_tokens(BitReader& reader, uint32_t token_count,
+                                uint32_t row_stride,
+                                std::vector<token_t>& tokens) {
+  std::vector<uint8_t> litlen_lengths, offset_lengths;
+  if (!read_code_lengths(reader, LITLEN_SYMBOLS, litlen_lengths) ||
+      !read_code_lengths(reader, OFFSET_SYMBOLS, offset_lengths)) {
     return false;
+  }
+  HuffmanTable litlen_table(litlen_lengths);
+  HuffmanTable offset_table(offset_lengths);
+
+  RepOffsets reps;
+  tokens.reserve(token_count);
+  for (uint32_t token_it = 0; token_it < token_count; token_it++) {
+    token_t token;
+    uint16_t symbol;
+    if (!read_symbol(reader, litlen_table, symbol)) {
+      return false;
+    }
+    if (symbol < 256) {
+      token.coded = false;
+      token.data.value = static_cast<uint8_t>(symbol);
+      tokens.push_back(token);
+      continue;
+    }
 
-  value = 0;
-  for (int i = 0; i < num_bits; i++) {
-    bool current_bit;
-    if (!read_bit_from_file(file, current_bit)) {
+    uint32_t length_bucket = symbol - 256;
+    uint32_t length = log2_bucket_base(length_bucket) +
+                      reader.read(log2_bucket_extra_bits(length_bucket));
+    uint16_t offset_symbol;
+    if (!read_symbol(reader, offset_table, offset_symbol)) {
       return false;
     }
-    value = (value << 1) | (current_bit ? 1 : 0);
+    uint32_t offset = read_offset(reader, offset_symbol, reps, row_stride);
+    if (length > UINT16_MAX || offset > UINT16_MAX) {
+      throw std::runtime_error("Huffman Error: Token field out of range.");
+    }
+    token.coded = true;
+    token.data.offset = static_cast<uint16_t>(offset);
+    token.data.length = static_cast<uint16_t>(length);
+    reps.update(token.data.offset);
+    tokens.push_back(token);
   }
-  return true;
+  return !reader.overrun();
 }
 
-bool read_blocks_from_file(const std::string& filename, uint32_t& width,
-                           uint32_t& height, uint32_t& offset_bits,
-                           uint16_t& length_bits, bool& adaptive, bool& model,
-                           std::vector<Block>& blocks, bool& binary_only) {
-  blocks.clear();
-  std::ifstream file(filename, std::ios::binary);
+// reads a frequency table stored by the writer as log2 buckets with extra
+// bits, a zero bucket is followed by the number of zeros after it
+static bool read_frequencies(BitReader& reader, size_t n_symbols,
+                             std::vector<uint32_t>& frequencies) {
+  frequencies.assign(n_symbols, 0);
+  for (size_t i = 0; i < n_symbols;) {
+    uint32_t bucket, extra;
+    if (!read_bits(reader, 4, bucket)) {
+      return false;
+    }
+    if (bucket != 0) {
+      if (!read_bits(reader, log2_bucket_extra_bits(bucket), extra)) {
+        return false;
+      }
+      frequencies[i++] = log2_bucket_base(bucket) + extra;
+      continue;
+    }
+    uint32_t run;
+    if (!read_bits(reader, 6, run)) {
+      return false;
+    }
+    if (i + run + 1 > n_symbols) {
+      throw std::runtime_error("rANS Error: Frequency run out of range.");
+    }
+    i += run + 1;
+  }
+  return true;
+}
 
-  if (!file) {
-    std::cerr << "Error opening file for reading: " << filename << std::endl;
-    reset_bit_reader_state();
+// reads the frequency tables and words of a block and decodes its tokens,
+// the extra bits of the buckets follow the words
+static bool read_rans_tokens(BitReader& reader, uint32_t token_count,
+                             uint32_t row_stride,
+                             std::vector<token_t>& tokens) {
+  std::vector<uint32_t> litlen_frequencies, offset_frequencies;
+  if (!read_frequencies(reader, LITLEN_SYMBOLS, litlen_frequencies) ||
+      !read_frequencies(reader, OFFSET_SYMBOLS, offset_frequencies)) {
     return false;
   }
+  RansTable litlen_table(litlen_frequencies);
+  RansTable offset_table(offset_frequencies);
 
-  reset_bit_reader_state();
-  uint8_t successful_compression;
-  try {
-    // read header not bit-packed for consistency
-    file.read(reinterpret_cast<char*>(&successful_compression),
-              sizeof(successful_compression));
-    file.read(reinterpret_cast<char*>(&width), sizeof(width));
-    file.read(reinterpret_cast<char*>(&height), sizeof(height));
-    file.read(reinterpret_cast<char*>(&offset_bits), sizeof(offset_bits));
-    file.read(reinterpret_cast<char*>(&length_bits), sizeof(length_bits));
+  uint32_t word_count;
+  if (!read_bits(reader, 32, word_count)) {
+    return false;
+  }
+  // every symbol renormalizes at most once, two symbols per token
+  if (word_count > 2 * static_cast<uint64_t>(token_count) + 2 * RANS_STREAMS) {
+    throw std::runtime_error("rANS Error: Word count out of range.");
+  }
+  std::vector<uint16_t> words(word_count);
+  for (auto& word : words) {
+    word = static_cast<uint16_t>(reader.read(16));
+  }
+  if (reader.overrun()) {
+    return false;
+  }
 
-    if (!file.good()) {
-      throw std::runtime_error("Failed to read file header.");
+  // the symbols come first, the extra bits are read once all are known
+  RansDecoder decoder(words);
+  tokens.reserve(token_count);
+  for (uint32_t token_it = 0; token_it < token_count; token_it++) {
+    token_t token;
+    uint16_t symbol;
+    if (!decoder.get(litlen_table, symbol)) {
+      throw std::runtime_error("rANS Error: Corrupted token stream.");
     }
-
-    if (!read_bit_from_file(file, model)) {
-      throw std::runtime_error("Failed to read model flag.");
+    if (symbol < 256) {
+      token.coded = false;
+      token.data.value = static_cast<uint8_t>(symbol);
+      tokens.push_back(token);
+      continue;
+    }
+    uint16_t offset_symbol;
+    if (!decoder.get(offset_table, offset_symbol)) {
+      throw std::runtime_error("rANS Error: Corrupted token stream.");
     }
+    token.coded = true;
+    token.data.length = static_cast<uint16_t>(symbol - 256);
+    token.data.offset = offset_symbol;
+    tokens.push_back(token);
+  }
 
-    if (!read_bit_from_file(file, adaptive)) {
-      throw std::runtime_error("Failed to read adaptive flag.");
+  // rep slots are resolved in token order along with the extra bits
+  RepOffsets reps;
+  for (auto& token : tokens) {
+    if (!token.coded) {
+      continue;
     }
+    uint32_t length_bucket = token.data.length;
+    uint32_t length = log2_bucket_base(length_bucket) +
+                      reader.read(log2_bucket_extra_bits(length_bucket));
+    uint32_t offset = read_offset(reader, token.data.offset, reps, row_stride);
+    if (length > UINT16_MAX || offset > UINT16_MAX) {
+      throw std::runtime_error("rANS Error: Token field out of range.");
+    }
+    token.data.offset = static_cast<uint16_t>(offset);
+    token.data.length = static_cast<uint16_t>(length);
+    reps.update(token.data.offset);
+  }
+  return !reader.overrun();
+}
+
+// reads the range coded flags of a raw block
+static bool read_flag_bytes(BitReader& reader, uint32_t token_count,
+                            std::vector<uint8_t>& bytes) {
+  uint32_t byte_count;
+  if (!read_bits(reader, 32, byte_count)) {
+    return false;
+  }
+  // a flag never costs more than a byte
+  if (byte_count > static_cast<uint64_t>(token_count) + 8) {
+    throw std::runtime_error("Range coder Error: Flag stream too long.");
+  }
+  bytes.resize(byte_count);
+  for (auto& byte : bytes) {
+    byte = static_cast<uint8_t>(reader.read(8));
+  }
+  return !reader.overrun();
+}
 
-    if (!read_bit_from_file(file, binary_only)) {
-      throw std::runtime_error("Failed to read adaptive flag.");
+// reads an exp-golomb code of the given order
+static bool read_exp_golomb(BitReader& reader, uint32_t order,
+                            uint32_t& value) {
+  reader.refill();
+  uint32_t zeros = std::countl_zero(reader.peek(32));
+  if (zeros + order > 16) {
+    // zeros past the end of the input are a truncated stream, not a bad code
+    reader.consume(zeros);
+    if (reader.overrun()) {
+      return false;
     }
+    throw std::runtime_error("Exp-Golomb Error: Code too long.");
+  }
+  reader.consume(zeros + 1);
+  uint32_t rest = reader.read(zeros + order);
+  value = ((1U << (zeros + order)) | rest) - (1U << order);
+  return true;
+}
 
-    if (adaptive) {
-      uint32_t temp_block_size;
-      if (!read_bits_from_file(file, 16, temp_block_size)) {
-        throw std::runtime_error(
-            "Failed to read block size for adaptive mode.");
-      }
+// reads the exp-golomb orders and the range coded flags of a block and
+// decodes its tokens
+static bool read_golomb_tokens(BitReader& reader, uint32_t token_count,
+                               uint32_t row_stride,
+                               std::vector<token_t>& tokens) {
+  uint32_t offset_order, length_order;
+  std::vector<uint8_t> flag_bytes;
+  if (!read_bits(reader, GOLOMB_ORDER_BITS, offset_order) ||
+      !read_bits(reader, GOLOMB_ORDER_BITS, length_order) ||
+      !read_flag_bytes(reader, token_count, flag_bytes)) {
+    return false;
+  }
 
-      if (temp_block_size > UINT16_MAX) {
-        throw std::runtime_error(
-            "Block size read from file exceeds uint16_t max.");
+  FlagModel flag_model;
+  BinaryRangeDecoder flag_decoder(flag_bytes);
+  RepOffsets reps;
+  tokens.reserve(token_count);
+  for (uint32_t token_it = 0; token_it < token_count; token_it++) {
+    token_t token;
+    token.coded = flag_decoder.decode(flag_model.probability());
+    if (token.coded) {
+      uint32_t symbol = decode_offset_symbol(flag_decoder, flag_model);
+      uint32_t offset, length;
+      if (symbol != 0) {
+        offset = implicit_offset(symbol, reps, row_stride) - 1;
+      } else if (!read_exp_golomb(reader, offset_order, offset)) {
+        return false;
+      }
+      if (!read_exp_golomb(reader, length_order, length)) {
+        return false;
       }
-      BLOCK_SIZE = static_cast<uint16_t>(temp_block_size);
-      if (BLOCK_SIZE == 0) {
-        throw std::runtime_error("Adaptive mode read invalid block size (0).");
+      if (offset + 1 > UINT16_MAX || length > UINT16_MAX) {
+        throw std::runtime_error("Exp-Golomb Error: Token field out of range.");
       }
+      token.data.offset = static_cast<uint16_t>(offset + 1);
+      token.data.length = static_cast<uint16_t>(length);
+      reps.update(token.data.offset);
+    } else {
+      token.data.value = static_cast<uint8_t>(reader.read(8));
     }
+    flag_model.update(token.coded, token.coded ? token.data.length : 0);
+    tokens.push_back(token);
+  }
+  return !reader.overrun();
+}
+
+// reads the range coded flags of a raw block and decodes its tokens, the
+// fields have fixed widths
+static bool read_raw_tokens(BitReader& reader, uint32_t token_count,
+                            uint32_t row_stride, uint32_t offset_bits,
+                            uint32_t length_bits,
+                            std::vector<token_t>& tokens) {
+  std::vector<uint8_t> flag_bytes;
+  if (!read_flag_bytes(reader, token_count, flag_bytes)) {
+    return false;
+  }
+
+  FlagModel flag_model;
+  BinaryRangeDecoder flag_decoder(flag_bytes);
+  RepOffsets reps;
+  tokens.reserve(token_count);
+  for (uint32_t token_it = 0; token_it < token_count; token_it++) {
+    token_t token;
+    token.coded = flag_decoder.decode(flag_model.probability());
+    if (token.coded) {
+      // the offset is stored unless it is a rep or row offset
+      uint32_t symbol = decode_offset_symbol(flag_decoder, flag_model);
+      uint32_t offset = symbol != 0
+                            ? implicit_offset(symbol, reps, row_stride)
+                            : reader.read(offset_bits);
+      uint32_t length = reader.read(length_bits);
+      if (offset == 1 && length == (1U << length_bits) - 1) {
+        // saturated run length, the remainder follows
+        length += reader.read(RUN_EXTENSION_BITS);
+      }
+      token.data.offset = static_cast<uint16_t>(offset);
+      token.data.length = static_cast<uint16_t>(length);
+      reps.update(token.data.offset);
+    } else {
+      token.data.value = static_cast<uint8_t>(reader.read(8));
+    }
+    flag_model.update(token.coded, token.coded ? token.data.length : 0);
+    tokens.push_back(token);
+  }
+  return !reader.overrun();
+}
+
+// reads the fields of the header stored natively, returns the format byte
+static uint8_t read_native_header(const uint8_t* header, uint32_t& width,
+                                  uint32_t& height, CodecParams& params) {
+  uint8_t format = header[0];
+  if (header[1] != FORMAT_VERSION) {
+    throw std::runtime_error("Unsupported format version " +
+                             std::to_string(header[1]) + ".");
+  }
+  header += 2 * sizeof(uint8_t);
+  std::memcpy(&width, header, sizeof(width));
+  header += sizeof(width);
+  std::memcpy(&height, header, sizeof(height));
+  header += sizeof(height);
+  std::memcpy(&params.offset_bits, header, sizeof(params.offset_bits));
+  header += sizeof(params.offset_bits);
+  std::memcpy(&params.length_bits, header, sizeof(params.length_bits));
+  if (params.offset_bits > 32 || params.length_bits > 32) {
+    throw std::runtime_error("Invalid token field widths.");
+  }
+  return format;
+}
+
+// reads the bit packed part of the header, sets the block size in adaptive
+// mode
+static void read_header_bits(BitReader& reader, bool& adaptive, bool& model,
+                             bool& bwt, EntropyMode& entropy_mode,
+                             Palette& palette, CodecParams& params) {
+  if (!read_bit(reader, model)) {
+    throw std::runtime_error("Failed to read model flag.");
+  }
+
+  if (!read_bit(reader, adaptive)) {
+    throw std::runtime_error("Failed to read adaptive flag.");
+  }
+
+  if (!read_bit(reader, bwt)) {
+    throw std::runtime_error("Failed to read BWT flag.");
+  }
+
+  uint32_t temp_entropy_mode;
+  if (!read_bits(reader, ENTROPY_MODE_BITS, temp_entropy_mode)) {
+    throw std::runtime_error("Failed to read entropy mode.");
+  }
+  if (temp_entropy_mode > ENTROPY_GOLOMB) {
+    throw std::runtime_error("Unknown entropy mode.");
+  }
+  entropy_mode = temp_entropy_mode;
 
-    uint16_t n_row_blocks = 1;
-    uint16_t n_col_blocks = 1;
-    if (adaptive) {
-      if (BLOCK_SIZE == 0) {
-        throw std::runtime_error(
-            "Cannot calculate blocks: Adaptive mode but block size is zero.");
+  bool packed;
+  if (!read_bit(reader, packed)) {
+    throw std::runtime_error("Failed to read palette flag.");
+  }
+
+  palette = Palette();
+  if (packed) {
+    uint32_t bits_per_pixel, n_colors;
+    if (!read_bits(reader, 3, bits_per_pixel) ||
+        !read_bits(reader, 4, n_colors)) {
+      throw std::runtime_error("Failed to read palette.");
+    }
+    n_colors++;
+    if ((bits_per_pixel != 1 && bits_per_pixel != 2 && bits_per_pixel != 4) ||
+        n_colors > (1U << bits_per_pixel)) {
+      throw std::runtime_error("Invalid palette bit depth.");
+    }
+    palette.bits_per_pixel = static_cast<uint8_t>(bits_per_pixel);
+    for (uint32_t k = 0; k < n_colors; k++) {
+      uint32_t color;
+      if (!read_bits(reader, 8, color)) {
+        throw std::runtime_error("Failed to read palette.");
       }
-      n_row_blocks = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
-      n_col_blocks = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
-    }
-
-    for (uint16_t row = 0; row < n_row_blocks; row++) {
-      for (uint16_t col = 0; col < n_col_blocks; col++) {
-        // calculate the current block's width and height
-        uint32_t current_block_width = width;
-        uint32_t current_block_height = height;
-        if (adaptive) {
-          current_block_width =
-              std::min<uint32_t>(BLOCK_SIZE, width - col * BLOCK_SIZE);
-          current_block_height =
-              std::min<uint32_t>(BLOCK_SIZE, height - row * BLOCK_SIZE);
-        }
-
-        // read the strategy from the file
-        uint32_t strategy_val = DEFAULT;
-        if (adaptive) {
-          if (!read_bits_from_file(file, 2, strategy_val)) {
-            std::cerr << "Warning: EOF or read error encountered while reading "
-                         "strategy for block ("
-                      << row << "," << col << ")." << std::endl;
-            throw std::runtime_error(
-                "Failed to read strategy for block. Possible EOF or read "
-                "error.");
-          }
-        }
-
-        uint32_t token_count = 0;
-        read_bits_from_file(file, 32, token_count);
-
-        if (strategy_val >= N_STRATEGIES) {
-          std::cerr << "Error: Invalid strategy value read from file: "
-                    << strategy_val << " for block (" << row << "," << col
-                    << ")." << std::endl;
-          reset_bit_reader_state();
-          return false;
-        }
-
-        SerializationStrategy strategy =
-            static_cast<SerializationStrategy>(strategy_val);
-
-        Block block(current_block_width, current_block_height, strategy);
-        for (uint32_t token_it = 0; token_it < token_count; token_it++) {
-          // read tokens for the block
-          token_t token;
-          bool flag_bit;
-          // read coded flag (1 bit)
-          if (!read_bit_from_file(file, flag_bit)) {
-            // EOF hit unexpectedly before the block was fully decoded
-            goto end_reading;  // exit loops
-          }
-          token.coded = flag_bit;
-
-          // read token data
-          if (token.coded) {
-            uint32_t temp_offset, temp_length;
-            // roded token: read offset and length
-            if (!read_bits_from_file(file, offset_bits, temp_offset)) {
-              std::cerr << "Warning: EOF encountered while reading offset for "
-                           "coded token in block ("
-                        << row << "," << col << ")." << std::endl;
-              goto end_reading;
-            }
-            token.data.offset = static_cast<uint16_t>(temp_offset);
-
-            if (!read_bits_from_file(file, length_bits, temp_length)) {
-              std::cerr << "Warning: EOF encountered while reading length for "
-                           "coded token in block ("
-                        << row << "," << col << ")." << std::endl;
-              goto end_reading;
-            }
-            token.data.length = static_cast<uint16_t>(temp_length);
-          } else {
-            uint32_t temp_value;
-            // uncoded token: read ASCII value (8 bits)
-            if (!read_bits_from_file(file, 8, temp_value)) {
-              std::cerr << "Warning: EOF encountered while reading value for "
-                           "uncoded token in block ("
-                        << row << "," << col << ")." << std::endl;
-              goto end_reading;
-            }
-            token.data.value = static_cast<uint8_t>(temp_value);
-          }
-
-          // if we successfully read all parts of the token, add it
-          block.m_tokens[strategy].push_back(token);
-        }
-
-        blocks.push_back(std::move(block));
+      palette.colors.push_back(static_cast<uint8_t>(color));
+    }
+    if (!read_bits(reader, 32, palette.width) ||
+        !read_bits(reader, 32, palette.height)) {
+      throw std::runtime_error("Failed to read unpacked dimensions.");
+    }
+  }
+
+  if (adaptive) {
+    uint32_t temp_block_size;
+    if (!read_bits(reader, 16, temp_block_size)) {
+      throw std::runtime_error("Failed to read block size for adaptive mode.");
+    }
+    params.block_size = static_cast<uint16_t>(temp_block_size);
+    if (params.block_size == 0) {
+      throw std::runtime_error("Adaptive mode read invalid block size (0).");
+    }
+  }
+}
+
+// reads the strategy and tokens of a block of the given dimensions, returns
+// false if the input ends prematurely
+static bool read_block(BitReader& reader, uint32_t block_width,
+                       uint32_t block_height, const CodecParams& params,
+                       bool adaptive, bool bwt, EntropyMode entropy_mode,
+                       std::vector<Block>& blocks) {
+  uint32_t strategy_val = DEFAULT;
+  if (adaptive && !read_bits(reader, 2, strategy_val)) {
+    throw std::runtime_error(
+        "Failed to read strategy for block. Possible EOF or read error.");
+  }
+  if (strategy_val >= N_STRATEGIES) {
+    throw std::runtime_error("Invalid strategy value read from file: " +
+                             std::to_string(strategy_val) + ".");
+  }
+  SerializationStrategy strategy =
+      static_cast<SerializationStrategy>(strategy_val);
+
+  std::vector<uint32_t> bwt_rows;
+  if (bwt) {
+    size_t block_size = static_cast<size_t>(block_width) * block_height;
+    bwt_rows.resize(bwt_chain_count(block_size));
+    for (auto& row : bwt_rows) {
+      if (!read_bits(reader, 32, row)) {
+        throw std::runtime_error("Failed to read BWT rows for block.");
       }
     }
+  }
 
-  } catch (const std::exception& e) {
-    std::cerr << "Error during file reading: " << e.what() << std::endl;
-    reset_bit_reader_state();  // reset state on error
-    file.close();
+  uint32_t token_count = reader.read(32);
+
+  Block block(block_width, block_height, strategy);
+  block.m_bwt_rows[strategy] = std::move(bwt_rows);
+  uint32_t row_stride = block.row_stride(strategy);
+  std::vector<token_t>& tokens = block.m_tokens[strategy];
+  bool complete;
+  if (entropy_mode == ENTROPY_HUFFMAN) {
+    complete = read_huffman_tokens(reader, token_count, row_stride, tokens);
+  } else if (entropy_mode == ENTROPY_RANS) {
+    complete = read_rans_tokens(reader, token_count, row_stride, tokens);
+  } else if (entropy_mode == ENTROPY_GOLOMB) {
+    complete = read_golomb_tokens(reader, token_count, row_stride, tokens);
+  } else {
+    complete = read_raw_tokens(reader, token_count, row_stride,
+                               params.offset_bits, params.length_bits, tokens);
+  }
+  if (complete) {
+    blocks.push_back(std::move(block));
+  }
+  return complete;
+}
+
+// reads the blocks of a band of rows, in adaptive mode a row of blocks
+// of block size columns, otherwise a single block
+static bool read_band(BitReader& reader, uint32_t width, uint32_t rows,
+                      const CodecParams& params, bool adaptive, bool bwt,
+                      EntropyMode entropy_mode, std::vector<Block>& blocks) {
+  uint32_t block_size = params.block_size;
+  uint32_t n_col_blocks = adaptive ? (width + block_size - 1) / block_size : 1;
+  for (uint32_t col = 0; col < n_col_blocks; col++) {
+    uint32_t block_width =
+        adaptive ? std::min<uint32_t>(block_size, width - col * block_size)
+                 : width;
+    if (!read_block(reader, block_width, rows, params, adaptive, bwt,
+                    entropy_mode, blocks)) {
+      std::cerr << "Warning: EOF encountered while reading tokens of block "
+                << blocks.size() << "." << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// the bit readers decode straight from the mapping, followed by the zero
+// padding they load past its end
+BlockIndex::BlockIndex(const std::string& filename)
+    : m_file(filename, BIT_READER_PADDING),
+      m_n_col_blocks(1) {
+  read_header();
+}
+
+BlockIndex::BlockIndex(std::span<const uint8_t> data)
+    : m_file(data, BIT_READER_PADDING),
+      m_n_col_blocks(1) {
+  read_header();
+}
+
+void BlockIndex::read_header() {
+  const uint8_t* data = m_file.data();
+  size_t size = m_file.size();
+  if (size < NATIVE_HEADER_SIZE) {
+    throw std::runtime_error("Failed to read file header.");
+  }
+
+  // read header not bit-packed for consistency
+  if (read_native_header(data, m_width, m_height, m_params) != FORMAT_IMAGE) {
+    throw std::runtime_error("Not a compressed image.");
+  }
+  BitReader reader(data + NATIVE_HEADER_SIZE, size - NATIVE_HEADER_SIZE);
+  read_header_bits(reader, m_adaptive, m_model, m_bwt, m_entropy_mode,
+                   m_palette, m_params);
+  size_t position = NATIVE_HEADER_SIZE + (reader.bits_consumed() + 7) / 8;
+
+  // blocks of block size rows and columns in adaptive mode, row by row
+  size_t n_expected = 1;
+  if (m_adaptive) {
+    uint32_t block_size = m_params.block_size;
+    m_n_col_blocks = (m_width + block_size - 1) / block_size;
+    n_expected = static_cast<size_t>(m_n_col_blocks) *
+                 ((m_height + block_size - 1) / block_size);
+  }
+
+  uint32_t n_blocks;
+  if (position + sizeof(n_blocks) > size) {
+    throw std::runtime_error("Failed to read seek table.");
+  }
+  std::memcpy(&n_blocks, data + position, sizeof(n_blocks));
+  position += sizeof(n_blocks);
+  if (n_blocks != n_expected ||
+      (size - position) / SEEK_TABLE_ENTRY_SIZE < n_blocks) {
+    throw std::runtime_error("Failed to read seek table.");
+  }
+
+  // offsets are stored from the end of the table
+  size_t payload_start = position + n_blocks * SEEK_TABLE_ENTRY_SIZE;
+  m_entries.resize(n_blocks);
+  for (auto& entry : m_entries) {
+    std::memcpy(&entry.offset, data + position, sizeof(entry.offset));
+    position += sizeof(entry.offset);
+    std::memcpy(&entry.size, data + position, sizeof(entry.size));
+    position += sizeof(entry.size);
+    entry.offset += payload_start;
+  }
+}
+
+size_t BlockIndex::size() const {
+  return m_entries.size();
+}
+
+uint32_t BlockIndex::column_count() const {
+  return m_n_col_blocks;
+}
+
+bool BlockIndex::read_block(size_t index, std::vector<Block>& blocks) const {
+  const Entry& entry = m_entries[index];
+  if (entry.offset > m_file.size() ||
+      entry.size > m_file.size() - entry.offset) {
+    return false;
+  }
+  uint32_t block_width = m_width;
+  uint32_t block_height = m_height;
+  if (m_adaptive) {
+    uint32_t row = index / m_n_col_blocks;
+    uint32_t col = index % m_n_col_blocks;
+    uint32_t block_size = m_params.block_size;
+    block_width = std::min<uint32_t>(block_size, m_width - col * block_size);
+    block_height = std::min<uint32_t>(block_size, m_height - row * block_size);
+  }
+  BitReader reader(m_file.data() + entry.offset, entry.size);
+  return ::read_block(reader, block_width, block_height, m_params, m_adaptive,
+                      m_bwt, m_entropy_mode, blocks);
+}
+
+// reads a frame of a stream, the bytes are followed by the bit reader padding
+static bool read_frame(std::istream& file, uint32_t& rows,
+                       std::vector<uint8_t>& bytes) {
+  uint64_t size;
+  file.read(reinterpret_cast<char*>(&rows), sizeof(rows));
+  file.read(reinterpret_cast<char*>(&size), sizeof(size));
+  if (!file.good()) {
     return false;
   }
+  bytes.assign(size + BIT_READER_PADDING, 0);
+  file.read(reinterpret_cast<char*>(bytes.data()),
+            static_cast<std::streamsize>(size));
+  return static_cast<uint64_t>(file.gcount()) == size;
+}
 
-end_reading:
-  // reset state after successful read or normal EOF break
-  reset_bit_reader_state();
-  file.close();
+bool read_stream_header(std::istream& file, uint32_t& width,
+                        CodecParams& params, bool& adaptive, bool& model,
+                        bool& bwt, EntropyMode& entropy_mode) {
+  try {
+    uint8_t header[NATIVE_HEADER_SIZE];
+    uint32_t height, rows;
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!file.good()) {
+      throw std::runtime_error("Failed to read file header.");
+    }
+    if (read_native_header(header, width, height, params) != FORMAT_STREAM) {
+      throw std::runtime_error("Not a compressed stream.");
+    }
+    std::vector<uint8_t> bytes;
+    if (!read_frame(file, rows, bytes) || rows != 0) {
+      throw std::runtime_error("Failed to read stream header.");
+    }
+    BitReader reader(bytes.data(), bytes.size() - BIT_READER_PADDING);
+    Palette palette;
+    read_header_bits(reader, adaptive, model, bwt, entropy_mode, palette,
+                     params);
+    if (palette.bits_per_pixel != 0) {
+      throw std::runtime_error("Streams cannot be palette packed.");
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Error during stream reading: " << e.what() << std::endl;
+    return false;
+  }
+  return true;
+}
 
+bool read_stream_band(std::istream& file, uint32_t width,
+                      const CodecParams& params, bool adaptive, bool bwt,
+                      EntropyMode entropy_mode, uint32_t& rows,
+                      std::vector<Block>& blocks) {
+  blocks.clear();
+  try {
+    std::vector<uint8_t> bytes;
+    if (!read_frame(file, rows, bytes)) {
+      throw std::runtime_error("Failed to read band.");
+    }
+    if (rows == 0) {
+      return true;
+    }
+    if (adaptive && rows > params.block_size) {
+      throw std::runtime_error("Band taller than the block size.");
+    }
+    BitReader reader(bytes.data(), bytes.size() - BIT_READER_PADDING);
+    if (!read_band(reader, width, rows, params, adaptive, bwt, entropy_mode,
+                   blocks)) {
+      return false;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Error during stream reading: " << e.what() << std::endl;
+    return false;
+  }
   return true;
 }
 
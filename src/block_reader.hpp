@@ -16,34 +16,119 @@
 #define BLOCK_READER_HPP
 
 #include <cstdint>
+#include <istream>
+#include <span>
 #include <string>
 #include <vector>
 
 #include "block.hpp"  // Include necessary header for Block class
+#include "mapped_file.hpp"
 #include "token.hpp"  // Include necessary header for token_t
+#include "transformations.hpp"
 
 /**
- * @brief Reads compressed data from a file, reconstructing header information
- * and tokenized blocks.
- * @param filename The path to the compressed input file.
+ * @class BlockIndex
+ * @brief A compressed image file mapped into memory together with its header
+ * and seek table. Any block can be read on its own, also from several threads
+ * at once.
+ */
+class BlockIndex {
+  public:
+  /**
+   * @brief Maps the file and reads its header and seek table. Throws if the
+   * file is not a compressed image.
+   * @param filename The path to the compressed input file.
+   */
+  explicit BlockIndex(const std::string& filename);
+
+  /**
+   * @brief Copies a compressed image held in memory and reads its header and
+   * seek table. Throws if the data are not a compressed image.
+   * @param data The compressed image.
+   */
+  explicit BlockIndex(std::span<const uint8_t> data);
+
+  /**
+   * @brief Gets the number of blocks of the image.
+   * @return Number of blocks, ordered row by row.
+   */
+  size_t size() const;
+
+  /**
+   * @brief Gets the number of blocks in a row of the image.
+   * @return Number of blocks per row, 1 unless adaptive mode was used.
+   */
+  uint32_t column_count() const;
+
+  /**
+   * @brief Reads the strategy and tokens of a block.
+   * @param index Index of the block.
+   * @param blocks Output parameter, the block is appended to it.
+   * @return False if the file ends within the block. Throws on corrupted
+   * data.
+   */
+  bool read_block(size_t index, std::vector<Block>& blocks) const;
+
+  uint32_t m_width;
+  uint32_t m_height;
+  CodecParams m_params;  // token fields and the block size of adaptive mode
+  bool m_adaptive;
+  bool m_model;
+  bool m_bwt;
+  EntropyMode m_entropy_mode;
+  Palette m_palette;  // bit depth and colors of packed data
+
+  private:
+  /**
+   * @brief Reads the header and the seek table of the file.
+   */
+  void read_header();
+
+  struct Entry {
+    uint64_t offset;  // from the start of the file
+    uint64_t size;
+  };
+
+  MappedFile m_file;
+  std::vector<Entry> m_entries;
+  uint32_t m_n_col_blocks;
+};
+
+/**
+ * @brief Reads the header of a stream of bands written by
+ * write_stream_header.
+ * @param file The input stream, positioned at its start.
  * @param width Output parameter for the width of the original data.
- * @param height Output parameter for the height of the original data.
- * @param offset_bits Output parameter for the number of bits used for offsets
- * in coded tokens.
- * @param length_bits Output parameter for the number of bits used for lengths
- * in coded tokens.
- * @param adaptive Output parameter indicating if adaptive mode was used during
- * compression.
- * @param model Output parameter indicating if model preprocessing was used
- * during compression.
- * @param blocks Output parameter, a vector to be filled with the reconstructed
- * Block objects containing tokens.
- * @return True if the file was read successfully and blocks were reconstructed,
- * false otherwise (e.g., file not found, read error, corrupted data).
+ * @param params Output parameter for the token parameters and the block size
+ * of adaptive mode.
+ * @param adaptive Output parameter indicating if adaptive mode was used.
+ * @param model Output parameter indicating if model preprocessing was used.
+ * @param bwt Output parameter indicating if the Burrows-Wheeler transform was
+ * used.
+ * @param entropy_mode Output parameter for the coding of the token fields.
+ * @return True if the header was read successfully, false otherwise.
+ */
+bool read_stream_header(std::istream& file, uint32_t& width,
+                        CodecParams& params, bool& adaptive, bool& model,
+                        bool& bwt, EntropyMode& entropy_mode);
+
+/**
+ * @brief Reads the blocks of the next band of a stream.
+ * @param file The input stream, positioned after the previous frame.
+ * @param width The width of the original data.
+ * @param params Token parameters and the block size read by
+ * read_stream_header.
+ * @param adaptive Flag indicating if adaptive mode was used.
+ * @param bwt Flag indicating if the Burrows-Wheeler transform was used.
+ * @param entropy_mode Coding of the token fields.
+ * @param rows Output parameter for the number of rows of the band, 0 at the
+ * end of the stream.
+ * @param blocks Output parameter, the blocks of the band.
+ * @return True if the band was read successfully, false otherwise.
  */
-bool read_blocks_from_file(const std::string& filename, uint32_t& width,
-                           uint32_t& height, uint32_t& offset_bits,
-                           uint16_t& length_bits, bool& adaptive, bool& model,
-                           std::vector<Block>& blocks, bool& binary_only);
+bool read_stream_band(std::istream& file, uint32_t width,
+                      const CodecParams& params, bool adaptive, bool bwt,
+                      EntropyMode entropy_mode, uint32_t& rows,
+                      std::vector<Block>& blocks);
 
 #endif  // BLOCK_READER_HPP
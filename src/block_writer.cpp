@@ -13,73 +13,631 @@
 
 #include "block_writer.hpp"
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <vector>
 
+#include "bit_writer.hpp"
 #include "block.hpp"
+#include "huffman.hpp"
+#include "range_coder.hpp"
+#include "rans.hpp"
 #include "token.hpp"
 
-uint8_t writer_buffer = 0;
-int writer_bit_count = 0;
+size_t token_size_bits(const token_t& token, const CodecParams& params) {
+  if (!token.coded) {
+    return TOKEN_UNCODED_LEN;
+  }
+  if (token.data.offset == 1 &&
+      token.data.length >= params.max_length_field()) {
+    return params.token_coded_len() + RUN_EXTENSION_BITS;
+  }
+  return params.token_coded_len();
+}
+
+// offset symbol of every coded token of a block: a row offset, a rep slot or
+// the log2 bucket of an explicit offset, the rows take precedence
+static std::vector<uint32_t> token_offset_symbols(
+    const std::vector<token_t>& tokens, uint32_t row_stride) {
+  std::vector<uint32_t> symbols(tokens.size(), 0);
+  RepOffsets reps;
+  for (size_t i = 0; i < tokens.size(); i++) {
+    if (!tokens[i].coded) {
+      continue;
+    }
+    uint32_t offset = tokens[i].data.offset;
+    int slot = reps.find(tokens[i].data.offset);
+    if (offset + 1 >= row_stride && offset <= row_stride + 1) {
+      symbols[i] = ROW_SYMBOL_BASE + offset + 1 - row_stride;
+    } else if (slot >= 0) {
+      symbols[i] = REP_SYMBOL_BASE + slot;
+    } else {
+      symbols[i] = log2_bucket(offset);
+    }
+    reps.update(tokens[i].data.offset);
+  }
+  return symbols;
+}
+
+// extra bits of an offset symbol, none for rep slots and rows
+static uint32_t offset_extra_bits(uint32_t symbol) {
+  return symbol >= OFFSET_BUCKETS ? 0 : log2_bucket_extra_bits(symbol);
+}
+
+// codes a value of the given number of bits most significant bit first as a
+// binary tree of adaptive probabilities
+template <typename Probability>
+static void encode_tree(BinaryRangeEncoder& encoder, uint32_t value,
+                        int n_bits, Probability probability) {
+  size_t node = 1;
+  for (int bit = n_bits; bit-- > 0;) {
+    bool tree_bit = (value >> bit) & 1;
+    encoder.encode(probability(node), tree_bit);
+    node = 2 * node + tree_bit;
+  }
+}
+
+// codes the flags of a block with the adaptive range coder, every coded flag
+// is followed by whether the token copies from the row above or uses a rep
+// slot, and which one
+static std::vector<uint8_t> encode_flags(
+    const std::vector<token_t>& tokens,
+    const std::vector<uint32_t>& offset_symbols) {
+  FlagModel model;
+  BinaryRangeEncoder encoder;
+  for (size_t i = 0; i < tokens.size(); i++) {
+    const token_t& token = tokens[i];
+    encoder.encode(model.probability(), token.coded);
+    if (token.coded) {
+      uint32_t symbol = offset_symbols[i];
+      encoder.encode(model.row_probability(), symbol >= ROW_SYMBOL_BASE);
+      if (symbol >= ROW_SYMBOL_BASE) {
+        encode_tree(encoder, symbol - ROW_SYMBOL_BASE, ROW_INDEX_BITS,
+                    [&](size_t node) -> uint16_t& {
+                      return model.row_index_probability(node);
+                    });
+      } else {
+        encoder.encode(model.rep_probability(), symbol >= REP_SYMBOL_BASE);
+        if (symbol >= REP_SYMBOL_BASE) {
+          encode_tree(encoder, symbol - REP_SYMBOL_BASE, REP_SLOT_BITS,
+                      [&](size_t node) -> uint16_t& {
+                        return model.slot_probability(node);
+                      });
+        }
+      }
+    }
+    model.update(token.coded, token.coded ? token.data.length : 0);
+  }
+  return encoder.finish();
+}
+
+// exp-golomb code of the given order, value + 2^order preceded by as many
+// zeros as it has bits above the order
+static size_t exp_golomb_bits(uint32_t value, uint32_t order) {
+  uint32_t width = std::bit_width(value + (1U << order));
+  return 2 * width - 1 - order;
+}
+
+static void write_exp_golomb(BitWriter& writer, uint32_t value,
+                             uint32_t order) {
+  uint32_t shifted = value + (1U << order);
+  uint32_t width = std::bit_width(shifted);
+  writer.write(0, width - 1 - order);
+  writer.write(shifted, width);
+}
+
+// exp-golomb orders of the offsets (minus one) and lengths of a block
+struct GolombOrders {
+  uint32_t offset;
+  uint32_t length;
+};
+
+// picks the cheapest orders and returns the size of the token fields
+static size_t golomb_fields_bits(const std::vector<token_t>& tokens,
+                                 const std::vector<uint32_t>& offset_symbols,
+                                 GolombOrders& orders) {
+  std::array<size_t, 1 << GOLOMB_ORDER_BITS> offset_bits = {};
+  std::array<size_t, 1 << GOLOMB_ORDER_BITS> length_bits = {};
+  size_t literal_bits = 0;
+  for (size_t i = 0; i < tokens.size(); i++) {
+    const token_t& token = tokens[i];
+    if (!token.coded) {
+      literal_bits += 8;
+      continue;
+    }
+    for (uint32_t order = 0; order < offset_bits.size(); order++) {
+      if (offset_symbols[i] < OFFSET_BUCKETS) {
+        offset_bits[order] += exp_golomb_bits(token.data.offset - 1, order);
+      }
+      length_bits[order] += exp_golomb_bits(token.data.length, order);
+    }
+  }
+  orders.offset = static_cast<uint32_t>(
+      std::min_element(offset_bits.begin(), offset_bits.end()) -
+      offset_bits.begin());
+  orders.length = static_cast<uint32_t>(
+      std::min_element(length_bits.begin(), length_bits.end()) -
+      length_bits.begin());
+  return literal_bits + offset_bits[orders.offset] +
+         length_bits[orders.length];
+}
+
+// code lengths of the literal/length and offset alphabets of a block
+struct HuffmanLengths {
+  std::vector<uint8_t> litlen;
+  std::vector<uint8_t> offset;
+};
+
+// counts the literal/length and offset bucket symbols of a block
+static void count_block_symbols(const std::vector<token_t>& tokens,
+                                const std::vector<uint32_t>& offset_symbols,
+                                std::vector<size_t>& litlen_counts,
+                                std::vector<size_t>& offset_counts) {
+  litlen_counts.assign(LITLEN_SYMBOLS, 0);
+  offset_counts.assign(OFFSET_SYMBOLS, 0);
+  for (size_t i = 0; i < tokens.size(); i++) {
+    if (tokens[i].coded) {
+      litlen_counts[256 + log2_bucket(tokens[i].data.length)]++;
+      offset_counts[offset_symbols[i]]++;
+    } else {
+      litlen_counts[tokens[i].data.value]++;
+    }
+  }
+}
+
+static HuffmanLengths block_code_lengths(
+    const std::vector<token_t>& tokens,
+    const std::vector<uint32_t>& offset_symbols) {
+  std::vector<size_t> litlen_counts, offset_counts;
+  count_block_symbols(tokens, offset_symbols, litlen_counts, offset_counts);
+  return {huffman_code_lengths(litlen_counts),
+          huffman_code_lengths(offset_counts)};
+}
+
+// number of zero entries of a table starting at the given one, at most 64
+template <typename T>
+static size_t zero_run(const std::vector<T>& table, size_t start) {
+  size_t run = 0;
+  while (start + run < table.size() && table[start + run] == 0 && run < 64) {
+    run++;
+  }
+  return run;
+}
+
+// lengths are stored in 4 bits, a zero is followed by 6 bits telling how many
+// more zeros follow it
+static size_t code_lengths_bits(const std::vector<uint8_t>& lengths) {
+  size_t bits = 0;
+  for (size_t i = 0; i < lengths.size();) {
+    bits += 4;
+    if (lengths[i] != 0) {
+      i++;
+    } else {
+      bits += 6;
+      i += zero_run(lengths, i);
+    }
+  }
+  return bits;
+}
+
+static void write_code_lengths(BitWriter& writer,
+                               const std::vector<uint8_t>& lengths) {
+  for (size_t i = 0; i < lengths.size();) {
+    writer.write(lengths[i], 4);
+    if (lengths[i] != 0) {
+      i++;
+    } else {
+      size_t run = zero_run(lengths, i);
+      writer.write(run - 1, 6);
+      i += run;
+    }
+  }
+}
 
-void reset_bit_writer_state() {
-  writer_buffer = 0;
-  writer_bit_count = 0;
+// frequencies are stored as a 4 bit log2 bucket followed by its extra bits,
+// the zero bucket is followed by 6 bits telling how many more zeros follow
+static size_t frequencies_bits(const std::vector<uint32_t>& frequencies) {
+  size_t bits = 0;
+  for (size_t i = 0; i < frequencies.size();) {
+    uint32_t bucket = log2_bucket(frequencies[i]);
+    bits += 4;
+    if (bucket != 0) {
+      bits += log2_bucket_extra_bits(bucket);
+      i++;
+    } else {
+      bits += 6;
+      i += zero_run(frequencies, i);
+    }
+  }
+  return bits;
 }
 
-void write_bit_to_file(std::ofstream& file, bool bit) {
-  if (!file.is_open() || !file.good()) {
-    throw std::runtime_error("File stream is not valid for writing.");
+static void write_frequencies(BitWriter& writer,
+                              const std::vector<uint32_t>& frequencies) {
+  for (size_t i = 0; i < frequencies.size();) {
+    uint32_t bucket = log2_bucket(frequencies[i]);
+    writer.write(bucket, 4);
+    if (bucket != 0) {
+      writer.write(frequencies[i] - log2_bucket_base(bucket),
+                   log2_bucket_extra_bits(bucket));
+      i++;
+    } else {
+      size_t run = zero_run(frequencies, i);
+      writer.write(run - 1, 6);
+      i += run;
+    }
   }
+}
 
-  writer_buffer = (writer_buffer << 1) | (bit ? 1 : 0);
-  writer_bit_count++;
+// symbols of a block coded by the interleaved rANS states, the extra bits of
+// the length and offset buckets are written after the words
+struct RansBlock {
+  std::vector<uint32_t> litlen_frequencies;
+  std::vector<uint32_t> offset_frequencies;
+  std::vector<uint16_t> words;
+  std::vector<std::pair<uint32_t, uint32_t>> extra_bits;  // value, bit count
+};
 
-  if (writer_bit_count == 8) {
-    file.write(reinterpret_cast<const char*>(&writer_buffer), 1);
-    if (!file.good()) {
-      throw std::runtime_error("Failed to write byte to file.");
+static RansBlock encode_rans_block(const std::vector<token_t>& tokens,
+                                   uint32_t row_stride) {
+  std::vector<uint32_t> offset_symbols =
+      token_offset_symbols(tokens, row_stride);
+  std::vector<size_t> litlen_counts, offset_counts;
+  count_block_symbols(tokens, offset_symbols, litlen_counts, offset_counts);
+  RansBlock block;
+  block.litlen_frequencies = rans_normalize_frequencies(litlen_counts);
+  block.offset_frequencies = rans_normalize_frequencies(offset_counts);
+  RansTable litlen_table(block.litlen_frequencies);
+  RansTable offset_table(block.offset_frequencies);
+
+  RansEncoder encoder;
+  for (size_t i = 0; i < tokens.size(); i++) {
+    const token_t& token = tokens[i];
+    if (!token.coded) {
+      encoder.put(litlen_table, token.data.value);
+      continue;
+    }
+    uint32_t length_bucket = log2_bucket(token.data.length);
+    encoder.put(litlen_table, static_cast<uint16_t>(256 + length_bucket));
+    block.extra_bits.push_back(
+        {token.data.length - log2_bucket_base(length_bucket),
+         log2_bucket_extra_bits(length_bucket)});
+    uint32_t offset_code = offset_symbols[i];
+    encoder.put(offset_table, static_cast<uint16_t>(offset_code));
+    if (offset_code < OFFSET_BUCKETS) {
+      block.extra_bits.push_back(
+          {token.data.offset - log2_bucket_base(offset_code),
+           log2_bucket_extra_bits(offset_code)});
     }
-    writer_buffer = 0;
-    writer_bit_count = 0;
   }
+  block.words = encoder.finish();
+  return block;
 }
 
-void write_bits_to_file(std::ofstream& file, uint32_t value, int num_bits) {
-  if (num_bits < 0 || num_bits > 32) {
-    throw std::out_of_range("Number of bits must be between 0 and 32.");
+size_t block_payload_bits(const std::vector<token_t>& tokens,
+                          uint32_t row_stride, EntropyMode entropy_mode,
+                          const CodecParams& params) {
+  size_t bits = 0;
+  std::vector<uint32_t> offset_symbols =
+      token_offset_symbols(tokens, row_stride);
+  if (entropy_mode == ENTROPY_RAW) {
+    // the flags and rep slots are range coded in front of the fields
+    bits += 32 + 8 * encode_flags(tokens, offset_symbols).size();
+    for (size_t i = 0; i < tokens.size(); i++) {
+      bits += token_size_bits(tokens[i], params) - 1;
+      if (offset_symbols[i] >= OFFSET_BUCKETS) {
+        bits -= params.offset_bits;
+      }
+    }
+    return bits;
   }
-  for (int i = num_bits - 1; i >= 0; i--) {
-    write_bit_to_file(file, (value >> i) & 1);
+  if (entropy_mode == ENTROPY_GOLOMB) {
+    // orders, range coded flags and the fields
+    GolombOrders orders;
+    bits += 2 * GOLOMB_ORDER_BITS + 32 +
+            8 * encode_flags(tokens, offset_symbols).size();
+    return bits + golomb_fields_bits(tokens, offset_symbols, orders);
   }
+  if (entropy_mode == ENTROPY_RANS) {
+    RansBlock block = encode_rans_block(tokens, row_stride);
+    bits += frequencies_bits(block.litlen_frequencies) +
+            frequencies_bits(block.offset_frequencies);
+    bits += 32 + 16 * block.words.size();
+    for (const auto& extra : block.extra_bits) {
+      bits += extra.second;
+    }
+    return bits;
+  }
+
+  HuffmanLengths lengths = block_code_lengths(tokens, offset_symbols);
+  bits += code_lengths_bits(lengths.litlen) + code_lengths_bits(lengths.offset);
+  for (size_t i = 0; i < tokens.size(); i++) {
+    const token_t& token = tokens[i];
+    if (token.coded) {
+      uint32_t length_bucket = log2_bucket(token.data.length);
+      uint32_t offset_code = offset_symbols[i];
+      bits += lengths.litlen[256 + length_bucket] +
+              log2_bucket_extra_bits(length_bucket) +
+              lengths.offset[offset_code] + offset_extra_bits(offset_code);
+    } else {
+      bits += lengths.litlen[token.data.value];
+    }
+  }
+  return bits;
 }
 
-void flush_bits_to_file(std::ofstream& file) {
-  if (!file.is_open() || !file.good()) {
-    reset_bit_writer_state();
-    return;
+// writes the coded flag and the fixed width fields of every token
+static void write_raw_tokens(BitWriter& writer,
+                             const std::vector<token_t>& tokens,
+                             uint32_t row_stride, const CodecParams& params) {
+  uint32_t offset_length = params.offset_bits;
+  uint16_t length_bits = params.length_bits;
+  uint32_t max_length_field = params.max_length_field();
+  // range coded flags and rep slots of all tokens first
+  std::vector<uint32_t> offset_symbols =
+      token_offset_symbols(tokens, row_stride);
+  std::vector<uint8_t> flags = encode_flags(tokens, offset_symbols);
+  writer.write(flags.size(), 32);
+  for (uint8_t byte : flags) {
+    writer.write(byte, 8);
   }
 
-  if (writer_bit_count > 0) {
-    writer_buffer <<= (8 - writer_bit_count);
-    file.write(reinterpret_cast<const char*>(&writer_buffer), 1);
-    if (!file.good()) {
-      std::cerr << "Warning: Failed to write final byte during flush."
-                << std::endl;
+  for (size_t i = 0; i < tokens.size(); i++) {
+    const token_t& token = tokens[i];
+    // write token data
+    if (token.coded) {
+      // Coded token: write offset and length with specified bit lengths
+      if (offset_length > 31 || length_bits > 16) {
+        throw std::out_of_range(
+            "Offset/Length bit size too large for uint16_t.");
+      }
+      if (offset_symbols[i] < OFFSET_BUCKETS) {
+        writer.write(token.data.offset, offset_length);
+      }
+      if (token.data.offset == 1 && token.data.length >= max_length_field) {
+        // run longer than the length field, store the remainder
+        writer.write(max_length_field, length_bits);
+        writer.write(token.data.length - max_length_field,
+                     RUN_EXTENSION_BITS);
+      } else {
+        writer.write(token.data.length, length_bits);
+      }
+    } else {
+      // uncoded token: write ASCII value (8 bits)
+      writer.write(token.data.value, 8);
     }
   }
-  // reset state after flushing
-  reset_bit_writer_state();
+}
+
+// writes the code tables of the block followed by the coded tokens, literals
+// and length buckets share one alphabet so no coded flag is needed
+static void write_huffman_tokens(BitWriter& writer,
+                                 const std::vector<token_t>& tokens,
+                                 uint32_t row_stride) {
+  std::vector<uint32_t> offset_symbols =
+      token_offset_symbols(tokens, row_stride);
+  HuffmanLengths lengths = block_code_lengths(tokens, offset_symbols);
+  write_code_lengths(writer, lengths.litlen);
+  write_code_lengths(writer, lengths.offset);
+  std::vector<uint32_t> litlen_codes = huffman_canonical_codes(lengths.litlen);
+  std::vector<uint32_t> offset_codes = huffman_canonical_codes(lengths.offset);
+
+  for (size_t i = 0; i < tokens.size(); i++) {
+    const token_t& token = tokens[i];
+    if (!token.coded) {
+      writer.write(litlen_codes[token.data.value],
+                   lengths.litlen[token.data.value]);
+      continue;
+    }
+    uint32_t symbol = 256 + log2_bucket(token.data.length);
+    writer.write(litlen_codes[symbol], lengths.litlen[symbol]);
+    uint32_t extra_bits = log2_bucket_extra_bits(symbol - 256);
+    writer.write(token.data.length - log2_bucket_base(symbol - 256),
+                 extra_bits);
+
+    uint32_t offset_code = offset_symbols[i];
+    writer.write(offset_codes[offset_code], lengths.offset[offset_code]);
+    if (offset_code < OFFSET_BUCKETS) {
+      writer.write(token.data.offset - log2_bucket_base(offset_code),
+                   log2_bucket_extra_bits(offset_code));
+    }
+  }
+}
+
+// writes the frequency tables, the rANS words and the extra bits of a block
+static void write_rans_tokens(BitWriter& writer,
+                              const std::vector<token_t>& tokens,
+                              uint32_t row_stride) {
+  RansBlock block = encode_rans_block(tokens, row_stride);
+  write_frequencies(writer, block.litlen_frequencies);
+  write_frequencies(writer, block.offset_frequencies);
+  writer.write(block.words.size(), 32);
+  for (uint16_t word : block.words) {
+    writer.write(word, 16);
+  }
+  for (const auto& [value, n_bits] : block.extra_bits) {
+    writer.write(value, n_bits);
+  }
+}
+
+// writes the exp-golomb orders and the range coded flags of the block
+// followed by the token fields
+static void write_golomb_tokens(BitWriter& writer,
+                                const std::vector<token_t>& tokens,
+                                uint32_t row_stride) {
+  std::vector<uint32_t> offset_symbols =
+      token_offset_symbols(tokens, row_stride);
+  GolombOrders orders;
+  golomb_fields_bits(tokens, offset_symbols, orders);
+  writer.write(orders.offset, GOLOMB_ORDER_BITS);
+  writer.write(orders.length, GOLOMB_ORDER_BITS);
+  std::vector<uint8_t> flags = encode_flags(tokens, offset_symbols);
+  writer.write(flags.size(), 32);
+  for (uint8_t byte : flags) {
+    writer.write(byte, 8);
+  }
+
+  for (size_t i = 0; i < tokens.size(); i++) {
+    const token_t& token = tokens[i];
+    if (token.coded) {
+      if (offset_symbols[i] < OFFSET_BUCKETS) {
+        write_exp_golomb(writer, token.data.offset - 1, orders.offset);
+      }
+      write_exp_golomb(writer, token.data.length, orders.length);
+    } else {
+      writer.write(token.data.value, 8);
+    }
+  }
+}
+
+size_t seek_table_bits(size_t n_blocks) {
+  return 32 + n_blocks * 2 * 64;
+}
+
+size_t palette_header_bits(const Palette& palette) {
+  if (palette.bits_per_pixel == 0) {
+    return 1;
+  }
+  // flag, bit depth, color count, colors and the unpacked dimensions
+  return 1 + 3 + 4 + 8 * palette.colors.size() + 32 + 32;
 }
 
 // function to write tokens to binary file with bit packing
+// writes the fields of the header stored natively
+static void write_native_header(std::ostream& file, uint8_t format,
+                                uint32_t width, uint32_t height,
+                                const CodecParams& params) {
+  uint8_t version = FORMAT_VERSION;
+  uint32_t offset_length = params.offset_bits;
+  uint16_t length_bits = params.length_bits;
+  file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+  file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+  file.write(reinterpret_cast<const char*>(&width), sizeof(width));
+  file.write(reinterpret_cast<const char*>(&height), sizeof(height));
+  file.write(reinterpret_cast<const char*>(&offset_length),
+             sizeof(offset_length));
+  file.write(reinterpret_cast<const char*>(&length_bits), sizeof(length_bits));
+}
+
+// writes the bit packed part of the header
+static void write_header_bits(BitWriter& writer, bool adaptive, bool model,
+                              bool bwt, EntropyMode entropy_mode,
+                              const Palette& palette,
+                              const CodecParams& params) {
+  writer.write_bit(model);
+  writer.write_bit(adaptive);
+  writer.write_bit(bwt);
+  writer.write(entropy_mode, ENTROPY_MODE_BITS);
+  writer.write_bit(palette.bits_per_pixel != 0);
+  if (palette.bits_per_pixel != 0) {
+    writer.write(palette.bits_per_pixel, 3);
+    writer.write(palette.colors.size() - 1, 4);
+    for (uint8_t color : palette.colors) {
+      writer.write(color, 8);
+    }
+    writer.write(palette.width, 32);
+    writer.write(palette.height, 32);
+  }
+  if (adaptive) {
+    writer.write(params.block_size, 16);
+  }
+}
+
+// writes the picked strategy of a block and its tokens
+static void write_block(BitWriter& writer, const Block& block,
+                        const CodecParams& params, bool adaptive, bool bwt,
+                        EntropyMode entropy_mode) {
+  if (adaptive) {
+    // write strategy as 2 bits
+    writer.write(block.m_picked_strategy, 2);
+  }
+  if (bwt) {
+    for (uint32_t row : block.m_bwt_rows[block.m_picked_strategy]) {
+      writer.write(row, 32);
+    }
+  }
+  const auto& tokens = block.m_tokens[block.m_picked_strategy];
+  uint32_t token_count = tokens.size();
+  writer.write(token_count, 32);
+
+  uint32_t row_stride = block.row_stride(block.m_picked_strategy);
+  if (entropy_mode == ENTROPY_HUFFMAN) {
+    write_huffman_tokens(writer, tokens, row_stride);
+  } else if (entropy_mode == ENTROPY_RANS) {
+    write_rans_tokens(writer, tokens, row_stride);
+  } else if (entropy_mode == ENTROPY_GOLOMB) {
+    write_golomb_tokens(writer, tokens, row_stride);
+  } else {
+    write_raw_tokens(writer, tokens, row_stride, params);
+  }
+}
+
+// writes the number of blocks followed by the offset of every payload from
+// the end of the table and its size
+static void write_seek_table(
+    std::ostream& file, const std::vector<std::vector<uint8_t>>& payloads) {
+  uint32_t n_blocks = payloads.size();
+  file.write(reinterpret_cast<const char*>(&n_blocks), sizeof(n_blocks));
+  uint64_t offset = 0;
+  for (const auto& payload : payloads) {
+    uint64_t size = payload.size();
+    file.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    offset += size;
+  }
+}
+
+// writes a frame of a stream, its number of rows and size precede the bytes
+static bool write_frame(std::ostream& file, uint32_t rows,
+                        const std::vector<uint8_t>& bytes) {
+  uint64_t size = bytes.size();
+  file.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+  file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  file.write(reinterpret_cast<const char*>(bytes.data()),
+             static_cast<std::streamsize>(bytes.size()));
+  return file.good();
+}
+
+void write_image(std::ostream& file, uint32_t width, uint32_t height,
+                 const CodecParams& params, bool adaptive, bool model,
+                 bool bwt, EntropyMode entropy_mode,
+                 const std::vector<Block>& blocks, const Palette& palette) {
+  BitWriter writer;
+  write_native_header(file, FORMAT_IMAGE, width, height, params);
+  write_header_bits(writer, adaptive, model, bwt, entropy_mode, palette,
+                    params);
+
+  if (!writer.finish(file))
+    throw std::runtime_error("Failed to write header.");
+
+  // every block is padded to whole bytes, so the seek table can locate it
+  std::vector<std::vector<uint8_t>> payloads;
+  payloads.reserve(blocks.size());
+  for (const auto& block : blocks) {
+    BitWriter block_writer;
+    write_block(block_writer, block, params, adaptive, bwt, entropy_mode);
+    payloads.push_back(block_writer.finish());
+  }
+  write_seek_table(file, payloads);
+  for (const auto& payload : payloads) {
+    file.write(reinterpret_cast<const char*>(payload.data()),
+               static_cast<std::streamsize>(payload.size()));
+  }
+  if (!file.good()) {
+    throw std::runtime_error("Failed to write blocks.");
+  }
+}
+
 bool write_blocks_to_stream(const std::string& filename, uint32_t width,
-                            uint32_t height, uint32_t offset_length,
-                            uint16_t length_bits, bool adaptive, bool model,
+                            uint32_t height, const CodecParams& params,
+                            bool adaptive, bool model, bool bwt,
+                            EntropyMode entropy_mode,
                             const std::vector<Block>& blocks,
-                            bool binary_only) {
+                            const Palette& palette) {
   std::ofstream file(filename, std::ios::binary);
 
   if (!file) {
@@ -87,63 +645,11 @@ bool write_blocks_to_stream(const std::string& filename, uint32_t width,
     return false;
   }
 
-  reset_bit_writer_state();
-  uint8_t successful_compression = 1;
   try {
-    file.write(reinterpret_cast<const char*>(&successful_compression),
-               sizeof(successful_compression));
-    file.write(reinterpret_cast<const char*>(&width), sizeof(width));
-    file.write(reinterpret_cast<const char*>(&height), sizeof(height));
-    file.write(reinterpret_cast<const char*>(&offset_length),
-               sizeof(offset_length));
-    file.write(reinterpret_cast<const char*>(&length_bits),
-               sizeof(length_bits));
-    write_bit_to_file(file, model);
-    write_bit_to_file(file, adaptive);
-    write_bit_to_file(file, binary_only);
-    if (adaptive) {
-      write_bits_to_file(file, BLOCK_SIZE, 16);
-    }
-
-    if (!file.good())
-      throw std::runtime_error("Failed to write header.");
-
-    for (const auto& block : blocks) {
-      if (adaptive) {
-        // write strategy as 2 bits
-        write_bits_to_file(file, block.m_picked_strategy, 2);
-      }
-      uint32_t token_count = block.m_tokens[block.m_picked_strategy].size();
-      write_bits_to_file(file, token_count, 32);
-
-      // write tokens with bit packing using functional helpers
-      for (const auto& token : block.m_tokens[block.m_picked_strategy]) {
-        // Write coded flag (1 bit)
-        write_bit_to_file(file, token.coded);
-
-        // write token data
-        if (token.coded) {
-          // Coded token: write offset and length with specified bit lengths
-          if (offset_length > 31 || length_bits > 16) {
-            throw std::out_of_range(
-                "Offset/Length bit size too large for uint16_t.");
-          }
-          write_bits_to_file(file, token.data.offset, offset_length);
-          write_bits_to_file(file, token.data.length, length_bits);
-        } else {
-          // uncoded token: write ASCII value (8 bits)
-          write_bits_to_file(file, token.data.value, 8);
-        }
-      }
-    }
-
-    // flush any remaining bits
-    flush_bits_to_file(file);  // Also resets state
-
+    write_image(file, width, height, params, adaptive, model, bwt,
+                entropy_mode, blocks, palette);
   } catch (const std::exception& e) {
     std::cerr << "Error during file writing: " << e.what() << std::endl;
-    // ensure state is reset even on error before closing
-    reset_bit_writer_state();
     file.close();
     return false;
   }
@@ -151,4 +657,30 @@ bool write_blocks_to_stream(const std::string& filename, uint32_t width,
   file.close();
   std::cout << "File written successfully: " << filename << std::endl;
   return true;
-}
\ No newline at end of file
+}
+
+bool write_stream_header(std::ostream& file, uint32_t width,
+                         const CodecParams& params, bool adaptive, bool model,
+                         bool bwt, EntropyMode entropy_mode) {
+  // the height is not known in advance, every band stores its rows
+  write_native_header(file, FORMAT_STREAM, width, 0, params);
+  BitWriter writer;
+  write_header_bits(writer, adaptive, model, bwt, entropy_mode, Palette(),
+                    params);
+  return write_frame(file, 0, writer.finish());
+}
+
+bool write_stream_band(std::ostream& file, uint32_t rows,
+                       const CodecParams& params, bool adaptive, bool bwt,
+                       EntropyMode entropy_mode,
+                       const std::vector<Block>& blocks) {
+  BitWriter writer;
+  for (const auto& block : blocks) {
+    write_block(writer, block, params, adaptive, bwt, entropy_mode);
+  }
+  return write_frame(file, rows, writer.finish());
+}
+
+bool write_stream_end(std::ostream& file) {
+  return write_frame(file, 0, {});
+}
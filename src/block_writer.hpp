@@ -16,27 +16,130 @@
 #define BLOCK_WRITER_HPP
 
 #include <cstdint>  // Include necessary types
-#include <string>   // Include necessary types
+#include <ostream>
+#include <string>  // Include necessary types
 #include <vector>
 
 #include "block.hpp"  // Include Block definition
+#include "token.hpp"
+#include "transformations.hpp"
 
 /**
- * @brief Writes the compressed data, including header and tokenized blocks, to
- * a file using bit packing.
+ * @brief Writes the compressed data to a file, the header followed by the seek
+ * table and the bit packed blocks, each padded to whole bytes.
  * @param filename The path to the output file.
  * @param width The width of the original data.
  * @param height The height of the original data.
- * @param offset_bits The number of bits used for offsets in coded tokens.
- * @param length_bits The number of bits used for lengths in coded tokens.
+ * @param params Token parameters and the block size of adaptive mode.
  * @param adaptive Flag indicating if adaptive mode was used.
  * @param model Flag indicating if model preprocessing was used.
+ * @param bwt Flag indicating if the Burrows-Wheeler transform was used.
+ * @param entropy_mode Coding of the token fields (raw, Huffman, rANS or
+ * Exp-Golomb).
  * @param blocks A vector of Block objects containing the tokens to be written.
+ * @param palette Palette of packed data (bit depth 0 if not packed).
  * @return True if writing was successful, false otherwise (e.g., file error).
  */
 bool write_blocks_to_stream(const std::string& filename, uint32_t width,
-                            uint32_t height, uint32_t offset_bits,
-                            uint16_t length_bits, bool adaptive, bool model,
-                            const std::vector<Block>& blocks, bool binary_only);
+                            uint32_t height, const CodecParams& params,
+                            bool adaptive, bool model, bool bwt,
+                            EntropyMode entropy_mode,
+                            const std::vector<Block>& blocks,
+                            const Palette& palette);
+
+/**
+ * @brief Writes the header, the seek table and the blocks of a compressed
+ * image. Throws if the stream fails.
+ * @param file The output stream.
+ * @param width The width of the original data.
+ * @param height The height of the original data.
+ * @param params Token parameters and the block size of adaptive mode.
+ * @param adaptive Flag indicating if adaptive mode was used.
+ * @param model Flag indicating if model preprocessing was used.
+ * @param bwt Flag indicating if the Burrows-Wheeler transform was used.
+ * @param entropy_mode Coding of the token fields.
+ * @param blocks The encoded blocks.
+ * @param palette Palette of packed data (bit depth 0 if not packed).
+ */
+void write_image(std::ostream& file, uint32_t width, uint32_t height,
+                 const CodecParams& params, bool adaptive, bool model,
+                 bool bwt, EntropyMode entropy_mode,
+                 const std::vector<Block>& blocks, const Palette& palette);
+
+/**
+ * @brief Starts a stream of bands, writing the header and the frame of the
+ * bit packed header fields. Streams are never palette packed.
+ * @param file The output stream.
+ * @param width The width of the original data.
+ * @param params Token parameters and the block size of adaptive mode.
+ * @param adaptive Flag indicating if adaptive mode was used.
+ * @param model Flag indicating if model preprocessing was used.
+ * @param bwt Flag indicating if the Burrows-Wheeler transform was used.
+ * @param entropy_mode Coding of the token fields.
+ * @return True if writing was successful, false otherwise.
+ */
+bool write_stream_header(std::ostream& file, uint32_t width,
+                         const CodecParams& params, bool adaptive, bool model,
+                         bool bwt, EntropyMode entropy_mode);
+
+/**
+ * @brief Writes the frame of one band of a stream, its number of rows and
+ * byte size followed by its blocks.
+ * @param file The output stream.
+ * @param rows Number of rows of the band, at least 1.
+ * @param params Token parameters of the stream.
+ * @param adaptive Flag indicating if adaptive mode was used.
+ * @param bwt Flag indicating if the Burrows-Wheeler transform was used.
+ * @param entropy_mode Coding of the token fields.
+ * @param blocks The encoded blocks of the band.
+ * @return True if writing was successful, false otherwise.
+ */
+bool write_stream_band(std::ostream& file, uint32_t rows,
+                       const CodecParams& params, bool adaptive, bool bwt,
+                       EntropyMode entropy_mode,
+                       const std::vector<Block>& blocks);
+
+/**
+ * @brief Ends a stream of bands with an empty frame.
+ * @param file The output stream.
+ * @return True if writing was successful, false otherwise.
+ */
+bool write_stream_end(std::ostream& file);
+
+/**
+ * @brief Calculates the number of bits the token occupies in the output
+ * stream, including the coded flag and a possible run length extension.
+ * @param token The token to measure.
+ * @param params Token parameters giving the field widths.
+ * @return Size of the written token in bits.
+ */
+size_t token_size_bits(const token_t& token, const CodecParams& params);
+
+/**
+ * @brief Computes the size of the seek table locating the blocks of an image.
+ * @param n_blocks Number of blocks of the image.
+ * @return Size of the table in bits.
+ */
+size_t seek_table_bits(size_t n_blocks);
+
+/**
+ * @brief Computes the size of the palette part of the header.
+ * @param palette The palette of the image, unpacked images have bit depth 0.
+ * @return Size of the palette fields in bits, including the flag bit.
+ */
+size_t palette_header_bits(const Palette& palette);
+
+/**
+ * @brief Calculates the number of bits the tokens of a block occupy in the
+ * output stream, including the code tables of the entropy coder.
+ * @param tokens The tokens of the block.
+ * @param row_stride Distance of the previous row in the serialized block.
+ * @param entropy_mode Coding of the token fields.
+ * @param params Token parameters giving the raw field widths.
+ * @return Size of the written tokens in bits.
+ */
+size_t block_payload_bits(const std::vector<token_t>& tokens,
+                          uint32_t row_stride, EntropyMode entropy_mode,
+                          const CodecParams& params);
 
 #endif  // BLOCK_WRITER_HPP
@@ -16,6 +16,7 @@
 #define COMMON_HPP
 
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 
 // debug priting options
@@ -25,13 +26,19 @@
 #define DEBUG_PRINT_TOKENS 0
 #define DEBUG_PRINT_COLLISIONS 0
 
-// packs eight bytes into one if the data vectors contain only 0x00 or 0xFF
-// useful for purely black and white images
-#define BINARY_ONLY 1
+// packs pixels into 1, 2 or 4 bit palette indices if the data contain at most
+// MAX_PALETTE_SIZE distinct values, useful for masks and label maps
+#define PALETTE_PACKING 1
+#define MAX_PALETTE_SIZE 16
 
 // minimum encode length
 #define MIN_CODED_LEN 3
 
+// coded tokens with offset 1 are runs of the previous byte, a saturated length
+// field of a run is followed by this many bits extending the length
+#define RUN_EXTENSION_BITS 16
+#define MAX_RUN_LEN (UINT16_MAX + MIN_CODED_LEN)
+
 #define DEFAULT_BLOCK_SIZE 512
 #define DEFAULT_OFFSET_BITS 16
 #define DEFAULT_LENGTH_BITS 10
@@ -39,21 +46,58 @@
 // use MTF, if 0 use delta transform
 #define MTF 1
 
-extern uint16_t SEARCH_BUF_SIZE;
-extern uint32_t OFFSET_BITS;
-extern uint16_t LENGTH_BITS;
-extern uint16_t MAX_CODED_LEN;
+// the inverse BWT walks up to BWT_CHAINS chains of at least BWT_MIN_CHAIN_LEN
+// bytes at once, the start row of every chain is stored with the block
+#define BWT_CHAINS 8
+#define BWT_MIN_CHAIN_LEN (1 << 16)
+
+// exp-golomb entropy mode, the order of the offsets and of the lengths is
+// picked per block and stored in this many bits
+#define GOLOMB_ORDER_BITS 4
+
+// use AVX2/SSE2 kernels where the target supports them, scalar otherwise
+#define USE_SIMD 1
+
+// size of an uncoded token, the coded flag and the byte
+#define TOKEN_UNCODED_LEN (1 + 8)
+
+// parameters of the coded tokens and of the split into blocks, every image
+// and stream is coded with its own
+struct CodecParams {
+  uint16_t block_size = DEFAULT_BLOCK_SIZE;
+  uint32_t offset_bits = DEFAULT_OFFSET_BITS;
+  uint16_t length_bits = DEFAULT_LENGTH_BITS;
+
+  // the farthest match the offset field can express, tokens store offsets in
+  // 16 bits
+  uint32_t search_buf_size() const {
+    return offset_bits >= 16 ? UINT16_MAX : (1U << offset_bits) - 1;
+  }
+
+  // the largest value of the length field, saturating it on a run announces
+  // the length extension
+  uint32_t max_length_field() const { return (1U << length_bits) - 1; }
 
-// used only for statistics printing
-extern size_t TOKEN_CODED_LEN;
-extern size_t TOKEN_UNCODED_LEN;
+  // the longest match, lengths are stored without MIN_CODED_LEN
+  uint32_t max_coded_len() const { return max_length_field() + MIN_CODED_LEN; }
+
+  // size of a coded token with an explicit offset, including the coded flag
+  size_t token_coded_len() const { return 1 + offset_bits + length_bits; }
+};
 
 struct StrategyResult {
   size_t n_coded_tokens;
   size_t n_unencoded_tokens;
+  size_t n_token_bits;
 };
 
-extern uint16_t BLOCK_SIZE;
+// rectangle of an image in pixels
+struct Region {
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+};
 
 constexpr size_t HORIZONTAL = 0;
 constexpr size_t VERTICAL = 1;
@@ -62,4 +106,22 @@ constexpr size_t DEFAULT = HORIZONTAL;
 
 using SerializationStrategy = std::size_t;
 
+// coding of the token fields, stored in the header
+constexpr size_t ENTROPY_RAW = 0;
+constexpr size_t ENTROPY_HUFFMAN = 1;
+constexpr size_t ENTROPY_RANS = 2;
+constexpr size_t ENTROPY_GOLOMB = 3;
+constexpr size_t ENTROPY_MODE_BITS = 2;
+
+using EntropyMode = std::size_t;
+
+// first byte of the output, the input copied as is, a single compressed image
+// or a compressed stream of bands of rows
+constexpr uint8_t FORMAT_UNCOMPRESSED = 0;
+constexpr uint8_t FORMAT_IMAGE = 1;
+constexpr uint8_t FORMAT_STREAM = 2;
+// layout of the compressed image and stream formats, stored after the first
+// byte, images are byte-aligned blocks located by a seek table
+constexpr uint8_t FORMAT_VERSION = 1;
+
 #endif  // COMMON_HPP
\ No newline at end of file
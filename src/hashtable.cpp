@@ -15,11 +15,12 @@
 
 #include <algorithm>
 #include <array>
+#include <bit>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
 const uint32_t TABLE_MASK = HASH_TABLE_SIZE - 1;
-uint16_t max_additional_length = (1U << LENGTH_BITS) - 1;
 
 inline uint32_t HashTable::hash_function(std::vector<uint8_t>& data,
                                          uint64_t position) {
@@ -39,7 +40,9 @@ inline uint32_t HashTable::hash_function(std::vector<uint8_t>& data,
   return k1 & TABLE_MASK;
 }
 
-HashTable::HashTable(uint32_t size) {
+HashTable::HashTable(uint32_t size, const CodecParams& params)
+    : m_search_buf_size(params.search_buf_size()),
+      m_max_length(static_cast<uint16_t>(params.max_length_field())) {
   table.resize(size);
 }
 
@@ -50,7 +53,8 @@ HashTable::~HashTable() {
 }
 
 search_result HashTable::search(std::vector<uint8_t>& data,
-                                uint64_t current_pos) {
+                                uint64_t current_pos, const RepOffsets& reps,
+                                uint32_t row_stride) {
   uint32_t key = hash_function(data, current_pos);
 
   const auto& bucket = table[key];
@@ -60,51 +64,74 @@ search_result HashTable::search(std::vector<uint8_t>& data,
       0,
   };
 
-  for (const HashNode& node_in_bucket : bucket) {
-    bool match = true;
-    // check if current_pos + MIN_CODED_LEN or node_in_bucket.position +
-    // MIN_CODED_LEN would go out of bounds
-    if (current_pos + MIN_CODED_LEN > data.size() ||
-        node_in_bucket.position + MIN_CODED_LEN > data.size()) {
+  if (current_pos + MIN_CODED_LEN > data.size()) {
+    return result;
+  }
+  const uint8_t* current = data.data() + current_pos;
+
+  // recently used offsets and the previous row are the cheapest to code,
+  // take the longest of them before looking at the bucket
+  std::array<uint64_t, REP_OFFSETS + ROW_OFFSETS> seeds;
+  for (int slot = 0; slot < REP_OFFSETS; slot++) {
+    seeds[slot] = reps[slot];
+  }
+  for (int k = 0; k < ROW_OFFSETS; k++) {
+    seeds[REP_OFFSETS + k] = static_cast<uint64_t>(row_stride) - 1 + k;
+  }
+  for (uint64_t offset : seeds) {
+    if (offset == 0 || offset > current_pos || offset > m_search_buf_size ||
+        std::memcmp(current, current - offset, MIN_CODED_LEN) != 0) {
+      continue;
+    }
+    uint16_t current_match_length =
+        match_length(data, current_pos, HashNode{current_pos - offset});
+    if (!result.found || current_match_length > result.length) {
+      result.length = current_match_length;
+      result.position = current_pos - offset;
+      result.found = true;
+    }
+  }
+  if (result.found &&
+      result.length >= std::min<uint16_t>(SEED_GOOD_LENGTH, m_max_length)) {
+    return result;
+  }
+
+  for (auto it = bucket.nodes.begin() + bucket.head; it != bucket.nodes.end();
+       ++it) {
+    const HashNode& node_in_bucket = *it;
+    // candidates always precede current_pos, so they are within bounds
+    const uint8_t* candidate = data.data() + node_in_bucket.position;
+
+    // a candidate can only beat the best match so far if it also matches the
+    // byte right after it, checking that one first rejects most candidates
+    size_t scan_end = MIN_CODED_LEN + result.length;
+    if (current_pos + scan_end >= data.size() ||
+        candidate[scan_end] != current[scan_end]) {
       continue;
     }
 
-    for (uint16_t i = 0; i < MIN_CODED_LEN; ++i) {
-      // check the bounds read past the end of data for either string
-      if (current_pos + i >= data.size() ||
-          node_in_bucket.position + i >= data.size()) {
-        match = false;
-        break;
-      }
-      uint8_t cmp1 = data[current_pos + i];
-      uint8_t cmp2 = data[node_in_bucket.position + i];
-      if (cmp1 != cmp2) {
+    if (std::memcmp(current, candidate, MIN_CODED_LEN) != 0) {
 #if DEBUG_PRINT_COLLISIONS
-        std::cout << "HashTable::search: hash collision!" << std::endl;
-        std::cout << "string1: ";
-        for (uint16_t j = 0; j < MIN_CODED_LEN; ++j) {
-          std::cout << static_cast<int>(data[current_pos + j]) << " ";
-        }
-        std::cout << "(";
-        for (uint16_t j = 0; j < MIN_CODED_LEN; ++j) {
-          std::cout << static_cast<char>(data[current_pos + j]);
-        }
-        std::cout << ")" << std::endl;
-        std::cout << "string2: ";
-        for (uint16_t j = 0; j < MIN_CODED_LEN; ++j) {
-          std::cout << static_cast<int>(data[current->position + j]) << " ";
-        }
-        std::cout << "(";
-        for (uint16_t j = 0; j < MIN_CODED_LEN; ++j) {
-          std::cout << static_cast<char>(data[current->position + j]);
-        }
-        std::cout << ")" << std::endl;
-#endif
-        match = false;
-        break;
+      std::cout << "HashTable::search: hash collision!" << std::endl;
+      std::cout << "string1: ";
+      for (uint16_t j = 0; j < MIN_CODED_LEN; ++j) {
+        std::cout << static_cast<int>(current[j]) << " ";
       }
-    }
-    if (!match) {
+      std::cout << "(";
+      for (uint16_t j = 0; j < MIN_CODED_LEN; ++j) {
+        std::cout << static_cast<char>(current[j]);
+      }
+      std::cout << ")" << std::endl;
+      std::cout << "string2: ";
+      for (uint16_t j = 0; j < MIN_CODED_LEN; ++j) {
+        std::cout << static_cast<int>(candidate[j]) << " ";
+      }
+      std::cout << "(";
+      for (uint16_t j = 0; j < MIN_CODED_LEN; ++j) {
+        std::cout << static_cast<char>(candidate[j]);
+      }
+      std::cout << ")" << std::endl;
+#endif
       continue;
     }
     uint16_t current_match_length =
@@ -113,6 +140,10 @@ search_result HashTable::search(std::vector<uint8_t>& data,
       result.length = current_match_length;
       result.position = node_in_bucket.position;
       result.found = true;
+      // nothing can beat a match of the maximum length
+      if (result.length == m_max_length) {
+        break;
+      }
     }
   }
   return result;
@@ -121,22 +152,32 @@ search_result HashTable::search(std::vector<uint8_t>& data,
 uint16_t HashTable::match_length(std::vector<uint8_t>& data,
                                  uint64_t current_pos,
                                  const HashNode& node_in_bucket) {
-  uint16_t current_match_length = 0;
-  for (uint16_t i = 0; i < max_additional_length; ++i) {
-    auto cmp1_index = current_pos + MIN_CODED_LEN + i;
-    auto cmp2_index = node_in_bucket.position + MIN_CODED_LEN + i;
-
-    if (cmp1_index >= data.size() || cmp2_index >= data.size()) {
-      break;
-    }
-
-    if (data[cmp1_index] == data[cmp2_index]) {
-      current_match_length++;
-    } else {
-      break;
+  // the candidate precedes current_pos, so only current_pos limits the length
+  if (current_pos + MIN_CODED_LEN >= data.size()) {
+    return 0;
+  }
+  const size_t limit = std::min<size_t>(
+      m_max_length, data.size() - (current_pos + MIN_CODED_LEN));
+  const uint8_t* current = data.data() + current_pos + MIN_CODED_LEN;
+  const uint8_t* candidate =
+      data.data() + node_in_bucket.position + MIN_CODED_LEN;
+
+  // compare eight bytes at a time, the lowest differing bit of the xor points
+  // at the first mismatching byte (little-endian)
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= limit; i += sizeof(uint64_t)) {
+    uint64_t current_word, candidate_word;
+    std::memcpy(&current_word, current + i, sizeof(uint64_t));
+    std::memcpy(&candidate_word, candidate + i, sizeof(uint64_t));
+    if (current_word != candidate_word) {
+      return static_cast<uint16_t>(
+          i + std::countr_zero(current_word ^ candidate_word) / 8);
     }
   }
-  return current_match_length;
+  while (i < limit && current[i] == candidate[i]) {
+    i++;
+  }
+  return static_cast<uint16_t>(i);
 }
 
 void HashTable::insert(std::vector<uint8_t>& data, uint64_t position) {
@@ -157,7 +198,7 @@ void HashTable::insert(std::vector<uint8_t>& data, uint64_t position) {
   std::cout << ")" << std::endl;
   std::cout << std::endl;
 #endif
-  table[index].insert(table[index].end(), {position});
+  table[index].nodes.push_back({position});
 }
 
 void HashTable::remove(std::vector<uint8_t>& data, uint64_t position) {
@@ -180,11 +221,26 @@ void HashTable::remove(std::vector<uint8_t>& data, uint64_t position) {
   std::cout << std::endl;
 #endif
 
-  auto it_to_remove = std::find_if(
-      bucket.begin(), bucket.end(),
-      [position](const HashNode& node) { return node.position == position; });
+  // buckets are filled in ascending order of positions, so a binary search
+  // finds the entry (and quickly skips positions that were never inserted)
+  auto live_begin = bucket.nodes.begin() + bucket.head;
+  auto it_to_remove = std::lower_bound(
+      live_begin, bucket.nodes.end(), position,
+      [](const HashNode& node, uint64_t pos) { return node.position < pos; });
 
-  if (it_to_remove != bucket.end()) {
-    bucket.erase(it_to_remove);
+  if (it_to_remove == bucket.nodes.end() ||
+      it_to_remove->position != position) {
+    return;
+  }
+  if (it_to_remove != live_begin) {
+    bucket.nodes.erase(it_to_remove);
+    return;
   }
-}
\ No newline at end of file
+  // the oldest entry leaves the window, drop it by advancing the head
+  bucket.head++;
+  if (bucket.head * 2 > bucket.nodes.size()) {
+    bucket.nodes.erase(bucket.nodes.begin(),
+                       bucket.nodes.begin() + bucket.head);
+    bucket.head = 0;
+  }
+}
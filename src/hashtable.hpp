@@ -19,10 +19,14 @@
 #include <vector>
 
 #include "common.hpp"
+#include "token.hpp"
 
 // Default size for the hash table (power of 2 for efficient masking)
 #define HASH_TABLE_SIZE (1024)
 
+// a rep or row match at least this long is taken without scanning the bucket
+#define SEED_GOOD_LENGTH 32
+
 /**
  * @struct search_result
  * @brief Structure to hold the result of a hash table search.
@@ -43,8 +47,10 @@ class HashTable {
   /**
    * @brief Constructs a HashTable with a specified size.
    * @param size The number of buckets in the hash table.
+   * @param params Token parameters limiting the offsets and lengths of the
+   * matches.
    */
-  HashTable(uint32_t size);
+  HashTable(uint32_t size, const CodecParams& params);
 
   /**
    * @brief Destroys the HashTable, freeing allocated memory if necessary.
@@ -71,13 +77,18 @@ class HashTable {
 
   /**
    * @brief Searches the hash table for the longest match for the sequence
-   * starting at the current position.
+   * starting at the current position. The recently used offsets and the
+   * neighbours in the previous row are tried first, a bucket candidate
+   * replaces them only if it is longer.
    * @param data The input data vector.
    * @param current_pos The current position in the data vector to search from.
+   * @param reps Offsets of the last coded tokens.
+   * @param row_stride Distance of the previous row in the data.
    * @return A search_result struct indicating if a match was found, its
    * position, and its length.
    */
-  struct search_result search(std::vector<uint8_t>& data, uint64_t current_pos);
+  struct search_result search(std::vector<uint8_t>& data, uint64_t current_pos,
+                              const RepOffsets& reps, uint32_t row_stride);
 
   private:
   /**
@@ -88,8 +99,20 @@ class HashTable {
     uint64_t position;  // Position in the input stream
   };
 
-  std::vector<std::vector<HashNode>>
-      table;  // Each element is a vector of HashNodes for a bucket
+  /**
+   * @struct Bucket
+   * @brief Positions hashed to one index, in ascending order. Entries leave
+   * the sliding window from the front, which only advances the head, the
+   * dead prefix is compacted once it outgrows the live part.
+   */
+  struct Bucket {
+    std::vector<HashNode> nodes;
+    size_t head = 0;
+  };
+
+  std::vector<Bucket> table;   // Each element is a bucket of HashNodes
+  uint32_t m_search_buf_size;  // farthest offset of a match
+  uint16_t m_max_length;       // longest match beyond MIN_CODED_LEN
 
   private:
   /**
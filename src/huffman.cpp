@@ -0,0 +1,184 @@
+/**
+ * @file      huffman.cpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Source file for the canonical Huffman codes of the token fields
+ *
+ * @date      12 April  2025 \n
+ */
+
+#include "huffman.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+uint32_t log2_bucket(uint32_t value) {
+  return std::bit_width(value);
+}
+
+uint32_t log2_bucket_extra_bits(uint32_t bucket) {
+  return bucket < 2 ? 0 : bucket - 1;
+}
+
+uint32_t log2_bucket_base(uint32_t bucket) {
+  return bucket < 2 ? bucket : 1U << (bucket - 1);
+}
+
+std::vector<uint8_t> huffman_code_lengths(std::vector<size_t> frequencies) {
+  std::vector<uint8_t> lengths(frequencies.size(), 0);
+  std::vector<size_t> used;
+  for (size_t symbol = 0; symbol < frequencies.size(); symbol++) {
+    if (frequencies[symbol] != 0) {
+      used.push_back(symbol);
+    }
+  }
+  if (used.empty()) {
+    return lengths;
+  }
+  if (used.size() == 1) {
+    lengths[used[0]] = 1;
+    return lengths;
+  }
+
+  using node_t = std::pair<size_t, size_t>;  // frequency, node index
+  while (true) {
+    // leaves come first, every inner node gets the next free index
+    std::vector<size_t> parent(2 * used.size() - 1);
+    std::priority_queue<node_t, std::vector<node_t>, std::greater<node_t>> heap;
+    for (size_t leaf = 0; leaf < used.size(); leaf++) {
+      heap.push({frequencies[used[leaf]], leaf});
+    }
+    size_t next_node = used.size();
+    while (heap.size() > 1) {
+      node_t first = heap.top();
+      heap.pop();
+      node_t second = heap.top();
+      heap.pop();
+      parent[first.second] = next_node;
+      parent[second.second] = next_node;
+      heap.push({first.first + second.first, next_node++});
+    }
+
+    // parents have higher indices than their children, the root is last
+    std::vector<size_t> depth(next_node, 0);
+    size_t max_depth = 0;
+    for (size_t node = next_node - 1; node-- > 0;) {
+      depth[node] = depth[parent[node]] + 1;
+      max_depth = std::max(max_depth, depth[node]);
+    }
+    if (max_depth <= HUFFMAN_MAX_CODE_LEN) {
+      for (size_t leaf = 0; leaf < used.size(); leaf++) {
+        lengths[used[leaf]] = static_cast<uint8_t>(depth[leaf]);
+      }
+      return lengths;
+    }
+
+    // too deep, flatten the distribution and build the tree again
+    for (size_t symbol : used) {
+      frequencies[symbol] = (frequencies[symbol] + 1) / 2;
+    }
+  }
+}
+
+std::vector<uint32_t> huffman_canonical_codes(
+    const std::vector<uint8_t>& lengths) {
+  std::array<uint32_t, HUFFMAN_MAX_CODE_LEN + 1> count = {};
+  for (uint8_t length : lengths) {
+    count[length]++;
+  }
+  count[0] = 0;
+  std::array<uint32_t, HUFFMAN_MAX_CODE_LEN + 1> next_code = {};
+  for (size_t length = 1; length <= HUFFMAN_MAX_CODE_LEN; length++) {
+    next_code[length] = (next_code[length - 1] + count[length - 1]) << 1;
+  }
+
+  std::vector<uint32_t> codes(lengths.size(), 0);
+  for (size_t symbol = 0; symbol < lengths.size(); symbol++) {
+    if (lengths[symbol] != 0) {
+      codes[symbol] = next_code[lengths[symbol]]++;
+    }
+  }
+  return codes;
+}
+
+HuffmanTable::HuffmanTable(const std::vector<uint8_t>& lengths)
+    : m_lookup(1U << HUFFMAN_TABLE_BITS, Entry{0, 0}) {
+  m_count.fill(0);
+  for (uint8_t length : lengths) {
+    if (length > HUFFMAN_MAX_CODE_LEN) {
+      throw std::runtime_error("Huffman Error: Code length out of range.");
+    }
+    m_count[length]++;
+  }
+  m_count[0] = 0;
+
+  // the codes must not claim more than the whole code space
+  uint64_t kraft_sum = 0;
+  for (size_t length = 1; length <= HUFFMAN_MAX_CODE_LEN; length++) {
+    kraft_sum += static_cast<uint64_t>(m_count[length])
+                 << (HUFFMAN_MAX_CODE_LEN - length);
+  }
+  if (kraft_sum > (1U << HUFFMAN_MAX_CODE_LEN)) {
+    throw std::runtime_error("Huffman Error: Code lengths are oversubscribed.");
+  }
+
+  m_first_code[0] = 0;
+  m_first_index[0] = 0;
+  for (size_t length = 1; length <= HUFFMAN_MAX_CODE_LEN; length++) {
+    m_first_code[length] =
+        (m_first_code[length - 1] + m_count[length - 1]) << 1;
+    m_first_index[length] = m_first_index[length - 1] + m_count[length - 1];
+  }
+
+  // symbols ordered by code length and value, i.e. by their canonical code
+  m_sorted_symbols.resize(m_first_index[HUFFMAN_MAX_CODE_LEN] +
+                          m_count[HUFFMAN_MAX_CODE_LEN]);
+  std::array<uint32_t, HUFFMAN_MAX_CODE_LEN + 1> next_index = m_first_index;
+  for (size_t symbol = 0; symbol < lengths.size(); symbol++) {
+    if (lengths[symbol] != 0) {
+      m_sorted_symbols[next_index[lengths[symbol]]++] =
+          static_cast<uint16_t>(symbol);
+    }
+  }
+
+  // every short code fills all table slots it is a prefix of
+  std::vector<uint32_t> codes = huffman_canonical_codes(lengths);
+  for (size_t symbol = 0; symbol < lengths.size(); symbol++) {
+    uint32_t length = lengths[symbol];
+    if (length == 0 || length > HUFFMAN_TABLE_BITS) {
+      continue;
+    }
+    uint32_t first = codes[symbol] << (HUFFMAN_TABLE_BITS - length);
+    uint32_t last = (codes[symbol] + 1) << (HUFFMAN_TABLE_BITS - length);
+    std::fill(m_lookup.begin() + first, m_lookup.begin() + last,
+              Entry{static_cast<uint16_t>(symbol),
+                    static_cast<uint8_t>(length)});
+  }
+}
+
+uint32_t HuffmanTable::decode(uint32_t window, uint16_t& symbol) const {
+  const Entry& entry =
+      m_lookup[window >> (HUFFMAN_MAX_CODE_LEN - HUFFMAN_TABLE_BITS)];
+  if (entry.length != 0) {
+    symbol = entry.symbol;
+    return entry.length;
+  }
+  for (uint32_t length = HUFFMAN_TABLE_BITS + 1;
+       length <= HUFFMAN_MAX_CODE_LEN; length++) {
+    uint32_t offset = (window >> (HUFFMAN_MAX_CODE_LEN - length)) -
+                      m_first_code[length];
+    if (offset < m_count[length]) {
+      symbol = m_sorted_symbols[m_first_index[length] + offset];
+      return length;
+    }
+  }
+  return 0;
+}
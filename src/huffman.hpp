@@ -0,0 +1,113 @@
+/**
+ * @file      huffman.hpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Header file for the canonical Huffman codes of the token fields
+ *
+ * @date      12 April  2025 \n
+ */
+
+#ifndef HUFFMAN_HPP
+#define HUFFMAN_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "token.hpp"
+
+// longest code, code lengths are stored in 4 bits
+#define HUFFMAN_MAX_CODE_LEN 15
+// codes up to this length are decoded by a single table lookup
+#define HUFFMAN_TABLE_BITS 10
+
+// lengths and offsets are coded as a log2 bucket followed by extra bits
+#define LENGTH_BUCKETS 17
+#define OFFSET_BUCKETS 32
+// literals 0-255 followed by the length buckets, like deflate
+#define LITLEN_SYMBOLS (256 + LENGTH_BUCKETS)
+// offset buckets followed by the rep slots and the row offsets, which have no
+// extra bits
+#define REP_SYMBOL_BASE OFFSET_BUCKETS
+#define ROW_SYMBOL_BASE (REP_SYMBOL_BASE + REP_OFFSETS)
+#define OFFSET_SYMBOLS (ROW_SYMBOL_BASE + ROW_OFFSETS)
+
+/**
+ * @brief Computes the log2 bucket of a value (its bit width).
+ * @param value The value to classify.
+ * @return Bucket of the value, 0 for 0.
+ */
+uint32_t log2_bucket(uint32_t value);
+
+/**
+ * @brief Computes the number of extra bits following a log2 bucket.
+ * @param bucket The bucket.
+ * @return Number of bits below the leading one of the bucket's values.
+ */
+uint32_t log2_bucket_extra_bits(uint32_t bucket);
+
+/**
+ * @brief Computes the smallest value of a log2 bucket.
+ * @param bucket The bucket.
+ * @return The value the extra bits are added to.
+ */
+uint32_t log2_bucket_base(uint32_t bucket);
+
+/**
+ * @brief Builds length-limited Huffman code lengths for the given symbol
+ * frequencies.
+ * @param frequencies Number of occurrences of every symbol.
+ * @return Code length of every symbol, 0 for unused symbols.
+ */
+std::vector<uint8_t> huffman_code_lengths(std::vector<size_t> frequencies);
+
+/**
+ * @brief Assigns canonical codes to the code lengths.
+ * @param lengths Code length of every symbol.
+ * @return Code of every symbol, to be written most significant bit first.
+ */
+std::vector<uint32_t> huffman_canonical_codes(
+    const std::vector<uint8_t>& lengths);
+
+/**
+ * @class HuffmanTable
+ * @brief Table-driven decoder of a canonical Huffman code. Short codes are
+ * resolved by one lookup, longer ones by the canonical first codes.
+ */
+class HuffmanTable {
+  public:
+  /**
+   * @brief Builds the decoding tables. Throws if the lengths do not form a
+   * prefix code.
+   * @param lengths Code length of every symbol.
+   */
+  explicit HuffmanTable(const std::vector<uint8_t>& lengths);
+
+  /**
+   * @brief Decodes the symbol at the start of a bit window.
+   * @param window The next HUFFMAN_MAX_CODE_LEN bits of the stream, the first
+   * one being the most significant.
+   * @param symbol The decoded symbol.
+   * @return Length of the decoded code, 0 if no code matches.
+   */
+  uint32_t decode(uint32_t window, uint16_t& symbol) const;
+
+  private:
+  struct Entry {
+    uint16_t symbol;
+    uint8_t length;  // 0 if the code is longer than HUFFMAN_TABLE_BITS
+  };
+
+  std::vector<Entry> m_lookup;
+  std::array<uint32_t, HUFFMAN_MAX_CODE_LEN + 1> m_first_code;
+  std::array<uint32_t, HUFFMAN_MAX_CODE_LEN + 1> m_count;
+  std::array<uint32_t, HUFFMAN_MAX_CODE_LEN + 1> m_first_index;
+  std::vector<uint16_t> m_sorted_symbols;
+};
+
+#endif  // HUFFMAN_HPP
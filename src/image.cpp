@@ -13,12 +13,17 @@
 
 #include "image.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "block.hpp"
@@ -29,16 +34,19 @@
 
 // constructor for encoding
 Image::Image(std::string i_filename, std::string o_filename, uint32_t width,
-             bool adaptive, bool model)
+             bool adaptive, bool model, bool bwt, EntropyMode entropy_mode,
+             const CodecParams& params)
     : m_input_filename(i_filename),
       m_output_filename(o_filename),
       m_width(width),
       m_adaptive(adaptive),
       m_model(model),
-      m_binary_only(true) {
-  // read the input file and store it in m_data vector
+      m_bwt(bwt),
+      m_entropy_mode(entropy_mode),
+      m_params(params) {
+  // map the input file, the blocks copy their data straight from it
   read_enc_input_file();
-  if (m_data.size() != static_cast<size_t>(m_width) * m_height) {
+  if (m_pixels.size() != static_cast<size_t>(m_width) * m_height) {
     throw std::runtime_error(
         "Error: Data size does not match image dimensions.");
   }
@@ -46,11 +54,82 @@ Image::Image(std::string i_filename, std::string o_filename, uint32_t width,
 
 // constructor for decoding
 Image::Image(std::string i_filename, std::string o_filename)
-    : m_input_filename(i_filename), m_output_filename(o_filename) {
-  // read the input file and store it in m_data vector
+    : m_input_filename(i_filename),
+      m_output_filename(o_filename),
+      m_width(0),
+      m_height(0),
+      m_adaptive(false),
+      m_model(false),
+      m_bwt(false),
+      m_entropy_mode(ENTROPY_HUFFMAN) {
+  // read the header of the input file, the blocks are read when decoding
   read_dec_input_file();
 }
 
+// constructor for encoding data held in memory
+Image::Image(std::span<const uint8_t> data, uint32_t width, bool adaptive,
+             bool model, bool bwt, EntropyMode entropy_mode,
+             const CodecParams& params)
+    : m_width(width),
+      m_height(0),
+      m_adaptive(adaptive),
+      m_model(model),
+      m_bwt(bwt),
+      m_entropy_mode(entropy_mode),
+      m_params(params) {
+  if (m_width == 0 || data.size() % m_width != 0 ||
+      data.size() / m_width > UINT32_MAX) {
+    throw std::runtime_error(
+        "Error: Data size does not match image dimensions.");
+  }
+  m_height = static_cast<uint32_t>(data.size() / m_width);
+  load_pixels(data);
+}
+
+// constructor for decoding a compressed image held in memory
+Image::Image(std::span<const uint8_t> compressed)
+    : m_width(0),
+      m_height(0),
+      m_adaptive(false),
+      m_model(false),
+      m_bwt(false),
+      m_entropy_mode(ENTROPY_HUFFMAN) {
+  m_index.emplace(compressed);
+  load_index();
+}
+
+// constructor for encoding a band of a stream
+Image::Image(std::vector<uint8_t> data, uint32_t width, uint32_t height,
+             bool adaptive, bool model, bool bwt, EntropyMode entropy_mode,
+             const CodecParams& params)
+    : m_width(width),
+      m_height(height),
+      m_adaptive(adaptive),
+      m_model(model),
+      m_bwt(bwt),
+      m_entropy_mode(entropy_mode),
+      m_params(params),
+      m_data(std::move(data)) {
+  m_pixels = m_data;
+  if (m_pixels.size() != static_cast<size_t>(m_width) * m_height) {
+    throw std::runtime_error(
+        "Error: Data size does not match image dimensions.");
+  }
+}
+
+// constructor for decoding a band of a stream
+Image::Image(std::vector<Block> blocks, uint32_t width, uint32_t height,
+             bool adaptive, bool model, bool bwt, const CodecParams& params)
+    : m_width(width),
+      m_height(height),
+      m_adaptive(adaptive),
+      m_model(model),
+      m_bwt(bwt),
+      m_entropy_mode(ENTROPY_HUFFMAN),
+      m_params(params),
+      m_blocks(std::move(blocks)) {
+}
+
 Image::~Image() {
   if (o_file_handle.is_open()) {
     o_file_handle.close();
@@ -58,37 +137,44 @@ Image::~Image() {
 }
 
 void Image::read_dec_input_file() {
-  // read the input file and store the tokens in m_tokens vector
-  // store all the params from header in the class variables
+  // read the header and the seek table, the blocks are read when decoding
+  try {
+    m_index.emplace(m_input_filename);
+  } catch (const std::exception& e) {
+    std::cerr << "Error during file reading: " << e.what() << std::endl;
+    return;
+  }
+  load_index();
+}
 
-  read_blocks_from_file(m_input_filename, m_width, m_height, OFFSET_BITS,
-                        LENGTH_BITS, m_adaptive, m_model, m_blocks,
-                        m_binary_only);
+void Image::load_index() {
+  // store all the params from header in the class variables
+  m_width = m_index->m_width;
+  m_height = m_index->m_height;
+  m_params = m_index->m_params;
+  m_adaptive = m_index->m_adaptive;
+  m_model = m_index->m_model;
+  m_bwt = m_index->m_bwt;
+  m_entropy_mode = m_index->m_entropy_mode;
+  m_palette = m_index->m_palette;
 }
 
 void Image::read_enc_input_file() {
-  std::ifstream file(m_input_filename, std::ios::binary);
-  if (!file) {
-    throw std::runtime_error("Error: Unable to open input file: " +
-                             m_input_filename);
-  }
-
-  file.seekg(0, std::ios::end);
-  auto length = file.tellg();
-  file.seekg(0, std::ios::beg);
+  m_input.emplace(m_input_filename);
+  size_t length = m_input->size();
 
   uint64_t temp_height = length / m_width;
 
   if (length > UINT32_MAX) {
     std::ostringstream error_msg;
     error_msg << "Error: Input file '" << m_input_filename
-              << "' is too large. Maximum size is " << UINT16_MAX << " bytes.";
+              << "' is too large. Maximum size is " << UINT32_MAX << " bytes.";
     throw std::runtime_error(error_msg.str());
   }
   m_height = static_cast<uint32_t>(temp_height);
 
   uint64_t expected_size = static_cast<uint64_t>(m_width) * m_height;
-  if (length < 0 || static_cast<uint64_t>(length) != expected_size) {
+  if (static_cast<uint64_t>(length) != expected_size) {
     std::ostringstream error_msg;
     error_msg << "Error: Input file '" << m_input_filename
               << "' size mismatch. Expected " << expected_size << " bytes ("
@@ -97,49 +183,94 @@ void Image::read_enc_input_file() {
     throw std::runtime_error(error_msg.str());
   }
 
-  m_data.resize(expected_size);
-  file.read(reinterpret_cast<char*>(m_data.data()), expected_size);
-  for (auto& symbol : m_data) {
-    if (symbol != 0 && symbol != 0xFF) {
-      m_binary_only = false;
-      break;
-    }
-  }
-#if BINARY_ONLY
-  if (m_binary_only) {
-    binary_only_pack(m_data, m_width, m_height, expected_size);
-  }
-#endif
-
-  if (m_data.size() != expected_size) {
-    std::ostringstream error_msg;
-    error_msg << "Error: Read incomplete data from file '" << m_input_filename
-              << "'. Expected " << expected_size << " bytes, read "
-              << m_data.size() << " bytes.";
-    throw std::runtime_error(error_msg.str());
-  }
+  load_pixels(std::span<const uint8_t>(m_input->data(), length));
 }
 
-void Image::write_dec_output_file() {
-#if BINARY_ONLY
-  if (m_binary_only) {
-    binary_only_unpack(m_data);
+void Image::load_pixels(std::span<const uint8_t> pixels) {
+  m_pixels = pixels;
+#if PALETTE_PACKING
+  // the model transforms byte values, several indices in one byte defeat it
+  Palette palette;
+  if (!m_pixels.empty() &&
+      build_palette(m_pixels.data(), m_pixels.size(), palette) &&
+      (!m_model || palette.bits_per_pixel == 1)) {
+    m_palette = palette;
+    m_data.assign(m_pixels.begin(), m_pixels.end());
+    palette_pack(m_data, m_width, m_height, m_palette);
+    m_pixels = m_data;
   }
 #endif
+}
 
+void Image::write_dec_output_file() {
   // write the decoded data to the output file
   std::ofstream o_file_handle(m_output_filename, std::ios::binary);
   if (!o_file_handle) {
     throw std::runtime_error("Error: Unable to open output file: " +
                              m_output_filename);
   }
-  o_file_handle.write(reinterpret_cast<const char*>(m_data.data()),
-                      m_data.size());
+  write_data(o_file_handle);
   o_file_handle.close();
   std::cout << "Decoded data written to: " << m_output_filename << std::endl;
   std::cout << "Written " << m_data.size() << " bytes." << std::endl;
 }
 
+void Image::unpack_data() {
+  if (m_palette.bits_per_pixel != 0) {
+    if (m_region) {
+      unpack_region();
+    } else {
+      palette_unpack(m_data, m_palette);
+    }
+    m_palette = Palette();
+  }
+}
+
+bool Image::write_data(std::ostream& stream) {
+  unpack_data();
+  stream.write(reinterpret_cast<const char*>(m_data.data()),
+               static_cast<std::streamsize>(m_data.size()));
+  return stream.good();
+}
+
+std::vector<uint8_t> Image::release_data() {
+  unpack_data();
+  return std::move(m_data);
+}
+
+void Image::unpack_region() {
+  // the window holds whole bytes, the pixels before the region in its first
+  // byte are skipped
+  uint32_t bits = m_palette.bits_per_pixel;
+  Palette window = m_palette;
+  size_t skip;
+  size_t n_rows;
+  size_t row_length;
+  if (m_palette.width == 1) {
+    window.width = 1;
+    window.height = m_window.height * 8 / bits;
+    skip = m_region->y - static_cast<size_t>(m_window.y) * 8 / bits;
+    n_rows = 1;
+    row_length = window.height;
+  } else {
+    window.width = m_window.width * 8 / bits;
+    window.height = m_window.height;
+    skip = m_region->x - static_cast<size_t>(m_window.x) * 8 / bits;
+    n_rows = window.height;
+    row_length = window.width;
+  }
+  palette_unpack(m_data, window);
+
+  size_t region_length = m_palette.width == 1 ? m_region->height
+                                               : m_region->width;
+  for (size_t row = 0; row < n_rows; row++) {
+    auto source = m_data.begin() + row * row_length + skip;
+    std::copy(source, source + region_length,
+              m_data.begin() + row * region_length);
+  }
+  m_data.resize(n_rows * region_length);
+}
+
 void Image::create_blocks() {
   if (!m_adaptive) {
     create_single_block();
@@ -157,60 +288,114 @@ void Image::print_blocks() {
 }
 
 void Image::encode_blocks() {
-  std::vector<token_t> tokens;
-  // iterate over all blocks, serialize, encode and write them
+  // the pixels of every strategy are scanned straight from the image into
+  // one buffer reused by all the blocks
+  std::vector<uint8_t> buffer;
   for (size_t i = 0; i < m_blocks.size(); i++) {
-    Block& block = m_blocks[i];
-    if (m_adaptive) {
-      block.serialize_all_strategies();
-      if (m_model)
-        for (size_t j = 0; j < N_STRATEGIES; j++) {
-#if MTF
-          block.mtf(static_cast<SerializationStrategy>(j));
-#else
-          block.delta_transform(static_cast<SerializationStrategy>(j));
-#endif
-        }
-      block.encode_adaptive();
-    } else {
-      if (m_model)
-#if MTF
-        block.mtf(DEFAULT);
-#else
-        block.delta_transform(DEFAULT);
-#endif
-      block.encode_using_strategy(DEFAULT);
-    }
+    encode_block(i, buffer);
+  }
+  release_input();
+}
+
+void Image::encode_block(size_t index, std::vector<uint8_t>& buffer) {
+  Block& block = m_blocks[index];
+  if (m_adaptive) {
+    block.encode_adaptive(m_entropy_mode, m_model, m_bwt, buffer);
+  } else {
+    block.encode(DEFAULT, m_model, m_bwt, buffer);
+  }
 #if DEBUG_PRINT
-    std::cout << "Block #" << i
-              << " picked strategy: " << block.m_picked_strategy << std::endl;
+  std::cout << "Block #" << index
+            << " picked strategy: " << block.m_picked_strategy << std::endl;
 #endif
 #if DEBUG_COMP_ENC_UNENC
-    block.decode_using_strategy(DEFAULT);
-    block.compare_encoded_decoded();
+  block.decode_using_strategy(DEFAULT);
+  block.compare_encoded_decoded();
 #endif
 #if DEBUG_PRINT_TOKENS
-    block.print_tokens();
+  block.print_tokens();
 #endif
-  }
+}
 
-  // m_data will not be needed anymore
+void Image::release_input() {
+  // the input will not be needed anymore
+  m_pixels = {};
   m_data.clear();
+  m_input.reset();
 }
 
 void Image::write_blocks() {
-  write_blocks_to_stream(m_output_filename, m_width, m_height, OFFSET_BITS,
-                         LENGTH_BITS, m_adaptive, m_model, m_blocks,
-                         m_binary_only);
+  write_blocks_to_stream(m_output_filename, m_width, m_height, m_params,
+                         m_adaptive, m_model, m_bwt, m_entropy_mode,
+                         m_blocks, m_palette);
 }
 
-void Image::decode_blocks() {
-  for (size_t i = 0; i < m_blocks.size(); i++) {
-    Block& block = m_blocks[i];
-    block.decode_using_strategy(DEFAULT);
+void Image::write_blocks(std::ostream& stream) {
+  write_image(stream, m_width, m_height, m_params, m_adaptive, m_model, m_bwt,
+              m_entropy_mode, m_blocks, m_palette);
+}
+
+void Image::set_region(const Region& region) {
+  if (!m_index) {
+    throw std::runtime_error(
+        "Error: Region decoding requires a compressed image.");
+  }
+  uint32_t width = m_palette.bits_per_pixel != 0 ? m_palette.width : m_width;
+  uint32_t height =
+      m_palette.bits_per_pixel != 0 ? m_palette.height : m_height;
+  if (region.width == 0 || region.height == 0 ||
+      static_cast<uint64_t>(region.x) + region.width > width ||
+      static_cast<uint64_t>(region.y) + region.height > height) {
+    std::ostringstream error_msg;
+    error_msg << "Error: Region " << region.x << "," << region.y << ","
+              << region.width << "," << region.height
+              << " exceeds the image dimensions (" << width << "x" << height
+              << ").";
+    throw std::runtime_error(error_msg.str());
+  }
+  m_region = region;
+}
+
+Region Image::coded_window() const {
+  if (!m_region) {
+    return {0, 0, m_width, m_height};
+  }
+  Region window = *m_region;
+  uint64_t bits = m_palette.bits_per_pixel;
+  if (bits == 0) {
+    return window;
+  }
+  // indices are packed along the rows, a single column as one long row
+  if (m_palette.width == 1) {
+    window.y = static_cast<uint32_t>(m_region->y * bits / 8);
+    window.height = static_cast<uint32_t>(
+        ((m_region->y + m_region->height) * bits + 7) / 8 - window.y);
+  } else {
+    window.x = static_cast<uint32_t>(m_region->x * bits / 8);
+    window.width = static_cast<uint32_t>(
+        ((m_region->x + m_region->width) * bits + 7) / 8 - window.x);
+  }
+  return window;
+}
+
+void Image::decode_blocks(unsigned threads) {
+  if (m_index) {
+    decode_indexed_blocks(threads);
+    return;
+  }
+  for (auto& block : m_blocks) {
+    decode_block(block);
+  }
+}
+
+void Image::decode_block(Block& block) {
+  block.decode_using_strategy(DEFAULT);
 #if DEBUG_PRINT_TOKENS
-    block.print_tokens();
+  block.print_tokens();
 #endif
+  // the model is otherwise reversed while placing the block, the BWT of the
+  // whole block stands in between
+  if (m_bwt) {
     if (m_model) {
 #if MTF
       block.reverse_mtf();
@@ -218,13 +403,120 @@ void Image::decode_blocks() {
       block.reverse_delta_transform();
 #endif
     }
-    if (m_adaptive) {
-      block.deserialize();
+    block.reverse_bwt();
+  }
+}
+
+void Image::place_block(const Block& block, uint32_t start_row,
+                        uint32_t start_col) {
+  if (static_cast<uint64_t>(start_row) + block.m_height > m_height ||
+      static_cast<uint64_t>(start_col) + block.m_width > m_width) {
+    throw std::runtime_error(
+        "Error composing image: Calculated destination index out of image "
+        "bounds.");
+  }
+  if (block.m_decoded_data.size() !=
+      static_cast<size_t>(block.m_width) * block.m_height) {
+    throw std::runtime_error(
+        "Error composing image: Decoded data size mismatch block "
+        "dimensions.");
+  }
+
+  // the rows and columns of the block inside the window are written straight
+  // to the final image, reversing the model and the serialization
+  uint32_t row_begin = std::max(start_row, m_window.y);
+  uint32_t row_end = std::min(start_row + block.m_height,
+                              m_window.y + m_window.height);
+  uint32_t col_begin = std::max(start_col, m_window.x);
+  uint32_t col_end =
+      std::min(start_col + block.m_width, m_window.x + m_window.width);
+  if (row_begin >= row_end || col_begin >= col_end) {
+    return;
+  }
+  Region window = {col_begin - start_col, row_begin - start_row,
+                   col_end - col_begin, row_end - row_begin};
+  uint8_t* destination =
+      m_data.data() +
+      static_cast<size_t>(row_begin - m_window.y) * m_window.width +
+      (col_begin - m_window.x);
+  block.place_decoded(m_model && !m_bwt, window, destination,
+                      m_window.width);
+}
+
+void Image::decode_indexed_blocks(unsigned threads) {
+  m_window = coded_window();
+  m_data.assign(static_cast<size_t>(m_window.width) * m_window.height, 0);
+  uint32_t n_col_blocks = m_index->column_count();
+  uint32_t block_size = m_params.block_size;
+
+  // only the blocks intersecting the window are read
+  std::vector<size_t> indices;
+  if (!m_adaptive) {
+    indices.push_back(0);
+  } else if (m_window.width != 0 && m_window.height != 0) {
+    uint32_t last_row = (m_window.y + m_window.height - 1) / block_size;
+    uint32_t last_col = (m_window.x + m_window.width - 1) / block_size;
+    for (uint32_t row = m_window.y / block_size; row <= last_row; row++) {
+      for (uint32_t col = m_window.x / block_size; col <= last_col; col++) {
+        indices.push_back(static_cast<size_t>(row) * n_col_blocks + col);
+      }
     }
   }
+  size_t n_blocks = indices.size();
+  if (threads == 0) {
+    threads = std::thread::hardware_concurrency();
+  }
+  threads = static_cast<unsigned>(
+      std::clamp<size_t>(threads, 1, std::max<size_t>(n_blocks, 1)));
+
+  // every worker takes the next block, reads its tokens from the mapped file
+  // and decodes it into its own part of the image
+  std::atomic<size_t> next_block{0};
+  std::mutex error_mutex;
+  std::exception_ptr error;
+  auto worker = [&]() {
+    std::vector<Block> blocks;
+    for (size_t next = next_block++; next < n_blocks; next = next_block++) {
+      size_t i = indices[next];
+      uint32_t row = i / n_col_blocks;
+      uint32_t col = i % n_col_blocks;
+      try {
+        blocks.clear();
+        if (!m_index->read_block(i, blocks)) {
+          throw std::runtime_error(
+              "Error composing image: EOF encountered while reading block (" +
+              std::to_string(row) + "," + std::to_string(col) + ").");
+        }
+        decode_block(blocks.front());
+        place_block(blocks.front(), row * block_size, col * block_size);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next_block = n_blocks;
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned t = 1; t < threads; t++) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : workers) {
+    thread.join();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
 }
 
 void Image::compose_image() {
+  if (m_index) {
+    return;
+  }
   if (m_blocks.empty()) {
     std::cerr << "Warning: No blocks available to compose the image."
               << std::endl;
@@ -235,6 +527,7 @@ void Image::compose_image() {
   uint64_t expected_size = static_cast<uint64_t>(m_width) * m_height;
 
   m_data.clear();
+  m_window = {0, 0, m_width, m_height};
 
   if (expected_size != 0) {
     m_data.resize(expected_size);
@@ -263,18 +556,19 @@ void Image::compose_image() {
           "non-adaptive mode.");
     }
 
-    m_data = single_block.m_decoded_data;
+    place_block(m_blocks[0], 0, 0);
 
   } else {
-    uint16_t n_blocks_rows = (m_height + BLOCK_SIZE - 1) / BLOCK_SIZE;
-    uint16_t n_blocks_cols = (m_width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint32_t block_size = m_params.block_size;
+    uint32_t n_blocks_rows = (m_height + block_size - 1) / block_size;
+    uint32_t n_blocks_cols = (m_width + block_size - 1) / block_size;
     size_t block_index = 0;
 
-    for (uint16_t block_r = 0; block_r < n_blocks_rows; ++block_r) {
-      uint16_t start_row = block_r * BLOCK_SIZE;
+    for (uint32_t block_r = 0; block_r < n_blocks_rows; ++block_r) {
+      uint32_t start_row = block_r * block_size;
 
-      for (uint16_t block_c = 0; block_c < n_blocks_cols; ++block_c) {
-        uint16_t start_col = block_c * BLOCK_SIZE;
+      for (uint32_t block_c = 0; block_c < n_blocks_cols; ++block_c) {
+        uint32_t start_col = block_c * block_size;
 
         if (block_index >= m_blocks.size()) {
           throw std::runtime_error(
@@ -282,41 +576,7 @@ void Image::compose_image() {
               "dimensions.");
         }
 
-        Block& current_block = m_blocks[block_index];
-        const std::vector<uint8_t>& block_data =
-            current_block.get_decoded_data();
-        uint16_t current_block_height = current_block.m_height;
-        uint16_t current_block_width = current_block.m_width;
-
-        size_t block_data_idx = 0;
-        // place data into the final image using correct destination indices
-        for (uint16_t r = 0; r < current_block_height; ++r) {
-          for (uint16_t c = 0; c < current_block_width; ++c) {
-            size_t dest_row = start_row + r;
-            size_t dest_col = start_col + c;
-
-            if (dest_row >= m_height || dest_col >= m_width) {
-              throw std::runtime_error(
-                  "Error composing image: Calculated destination index out "
-                  "of image bounds.");
-            }
-
-            // Index into final image data
-            size_t dest_index = dest_row * m_width + dest_col;
-            if (dest_index >= m_data.size()) {
-              throw std::runtime_error(
-                  "Error: Calculated destination index out of bounds during "
-                  "composition.");
-            }
-            if (block_data_idx >= block_data.size()) {
-              throw std::runtime_error(
-                  "Error: Source block data index out of bounds during "
-                  "composition.");
-            }
-
-            m_data[dest_index] = block_data[block_data_idx++];
-          }
-        }
+        place_block(m_blocks[block_index], start_row, start_col);
         block_index++;
       }
     }
@@ -348,33 +608,49 @@ bool Image::is_adaptive() {
   return m_adaptive;
 }
 
-bool Image::is_compression_successful() {
-  size_t coded = 0;
-  size_t uncoded = 0;
+const CodecParams& Image::get_params() const {
+  return m_params;
+}
+
+size_t Image::compressed_size() const {
+  // every block is padded to whole bytes, its strategy, chain rows and
+  // token count precede the tokens
+  size_t total_block_bits = 0;
   for (auto& block : m_blocks) {
-    auto strategy = block.m_picked_strategy;
-    coded += block.m_strategy_results[strategy].n_coded_tokens;
-    uncoded += block.m_strategy_results[strategy].n_unencoded_tokens;
+    SerializationStrategy strategy = block.m_picked_strategy;
+    size_t block_bits = 32 + block_payload_bits(block.m_tokens[strategy],
+                                                block.row_stride(strategy),
+                                                m_entropy_mode, m_params);
+    if (m_adaptive) {
+      block_bits += 2;
+    }
+    if (m_bwt) {
+      block_bits += 32 * block.m_bwt_rows[strategy].size();
+    }
+    total_block_bits += (block_bits + 7) / 8 * 8;
   }
-  size_t file_header_bits =
-      32 + 32 + 16 + 16 + 1 +
-      1;  // width, height, offset, length, model, adaptive
 
-  // block size
+  // model, adaptive and bwt flags, entropy mode, palette and block size
+  size_t header_bits = 3 + ENTROPY_MODE_BITS + palette_header_bits(m_palette);
   if (m_adaptive) {
-    file_header_bits += 16;
+    header_bits += 16;
   }
+  // format, version, width, height, offset and length bits are not packed
+  size_t file_header_bits = 8 + 8 + 32 + 32 + 32 + 16 +
+                            (header_bits + 7) / 8 * 8 +
+                            seek_table_bits(m_blocks.size());
 
-  size_t total_token_bits =
-      (TOKEN_CODED_LEN * coded) + (TOKEN_UNCODED_LEN * uncoded);
-
-  size_t total_strategy_bits = m_blocks.size() * 2;
-  size_t total_size_bits =
-      file_header_bits + total_token_bits + total_strategy_bits;
+  size_t total_size_bits = file_header_bits + total_block_bits;
+  return static_cast<size_t>(ceil(total_size_bits / 8.0));
+}
 
+bool Image::is_compression_successful() {
   size_t size_original = static_cast<size_t>(m_width) * m_height;
+  if (m_palette.bits_per_pixel != 0) {
+    size_original = static_cast<size_t>(m_palette.width) * m_palette.height;
+  }
 
-  size_t compressed_size = static_cast<size_t>(ceil(total_size_bits / 8.0));
+  size_t compressed_size = Image::compressed_size();
 
   // std::cout << "--- Compression Stats ---" << std::endl;
   std::cout << "Original Size: " << size_original << " bytes" << std::endl;
@@ -396,7 +672,7 @@ void Image::copy_unsuccessful_compression() {
   std::ofstream o_file_handle(m_output_filename, std::ios::binary);
 
   // write a zero byte to the output file
-  o_file_handle.put(0);
+  o_file_handle.put(FORMAT_UNCOMPRESSED);
   // open the input file and copy the data to the output file
   std::ifstream i_file_handle(m_input_filename, std::ios::binary);
   if (!i_file_handle) {
@@ -411,63 +687,37 @@ void Image::copy_unsuccessful_compression() {
 }
 
 void Image::create_single_block() {
-  // single block
+  // single block, a view of the whole image
   m_blocks.reserve(1);
-  m_blocks.push_back(Block(m_data, m_width, m_width));
+  m_blocks.emplace_back(m_pixels.data(), m_width, m_width, m_height,
+                        m_params);
 }
 
 void Image::create_multiple_blocks() {
   m_blocks.clear();
-  uint16_t n_blocks_rows = (m_height + BLOCK_SIZE - 1) / BLOCK_SIZE;
-  uint16_t n_blocks_cols = (m_width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  uint32_t block_size = m_params.block_size;
+  uint32_t n_blocks_rows = (m_height + block_size - 1) / block_size;
+  uint32_t n_blocks_cols = (m_width + block_size - 1) / block_size;
   m_blocks.reserve(static_cast<size_t>(n_blocks_rows) * n_blocks_cols);
+  if (m_pixels.size() != static_cast<size_t>(m_width) * m_height) {
+    throw std::runtime_error(
+        "Error: Calculated index out of bounds during block creation.");
+  }
 
-  for (uint16_t block_r = 0; block_r < n_blocks_rows; ++block_r) {
-    uint16_t start_row = block_r * BLOCK_SIZE;
+  // the blocks are views of the image, their pixels are read when encoding
+  for (uint32_t block_r = 0; block_r < n_blocks_rows; ++block_r) {
+    uint32_t start_row = block_r * block_size;
     uint16_t current_block_height =
-        std::min<uint16_t>(BLOCK_SIZE, m_height - start_row);
+        std::min<uint32_t>(block_size, m_height - start_row);
 
-    for (uint16_t block_c = 0; block_c < n_blocks_cols; ++block_c) {
-      uint16_t start_col = block_c * BLOCK_SIZE;
+    for (uint32_t block_c = 0; block_c < n_blocks_cols; ++block_c) {
+      uint32_t start_col = block_c * block_size;
       uint16_t current_block_width =
-          std::min<uint16_t>(BLOCK_SIZE, m_width - start_col);
-
-      std::vector<uint8_t> block_data;
-      block_data.reserve(static_cast<size_t>(current_block_width) *
-                         current_block_height);
-
-      for (uint16_t r = start_row; r < start_row + current_block_height; ++r) {
-        for (uint16_t c = start_col; c < start_col + current_block_width; ++c) {
-          size_t index = static_cast<size_t>(r) * m_width + c;
-          if (index >= m_data.size()) {
-            throw std::runtime_error(
-                "Error: Calculated index out of bounds during block "
-                "creation.");
-          }
-          block_data.push_back(m_data[index]);
-        }
-      }
-
-      if (block_data.size() !=
-          static_cast<size_t>(current_block_width) * current_block_height) {
-        std::cerr << "Error: Internal logic error during block creation. "
-                     "Size mismatch."
-                  << " Expected: "
-                  << (static_cast<size_t>(current_block_width) *
-                      current_block_height)
-                  << " Got: " << block_data.size() << std::endl;
-        throw std::runtime_error("Block data size mismatch during creation.");
-      }
-
-      m_blocks.emplace_back(std::move(block_data), current_block_width,
-                            current_block_height);
+          std::min<uint32_t>(block_size, m_width - start_col);
+      size_t index = static_cast<size_t>(start_row) * m_width + start_col;
+      m_blocks.emplace_back(m_pixels.data() + index, m_width,
+                            current_block_width, current_block_height,
+                            m_params);
     }
   }
-
-  if (m_blocks.size() != static_cast<size_t>(n_blocks_rows) * n_blocks_cols) {
-    std::cerr << "Warning: Number of created blocks (" << m_blocks.size()
-              << ") does not match expected count ("
-              << (static_cast<size_t>(n_blocks_rows) * n_blocks_cols) << ")."
-              << std::endl;
-  }
 }
@@ -15,12 +15,17 @@
 #define IMAGE_HPP
 
 #include <fstream>  // Include for std::ofstream
+#include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
 #include "block.hpp"
+#include "block_reader.hpp"
 #include "common.hpp"
+#include "mapped_file.hpp"
 #include "token.hpp"  // Include for token_t
+#include "transformations.hpp"
 
 /**
  * @class Image
@@ -36,9 +41,15 @@ class Image {
    * @param width Width of the image/data (used to calculate height).
    * @param adaptive Whether to use adaptive block strategy.
    * @param model Whether to use model preprocessing (delta/MTF).
+   * @param bwt Whether to apply the Burrows-Wheeler transform before the
+   * model.
+   * @param entropy_mode Coding of the token fields (raw, Huffman, rANS or
+ * Exp-Golomb).
+   * @param params Token parameters and the block size of adaptive mode.
    */
   Image(std::string i_filename, std::string o_filename, uint32_t width,
-        bool adaptive, bool model);
+        bool adaptive, bool model, bool bwt, EntropyMode entropy_mode,
+        const CodecParams& params);
 
   /**
    * @brief Constructor for decoding mode. Reads header and blocks from input
@@ -48,18 +59,73 @@ class Image {
    */
   Image(std::string i_filename, std::string o_filename);
 
+  /**
+   * @brief Constructor for encoding data held in memory. Throws if the size
+   * of the data is not a multiple of the width.
+   * @param data The pixels, they must stay valid until the blocks are
+   * encoded.
+   * @param width Width of the image/data (used to calculate height).
+   * @param adaptive Whether to use adaptive block strategy.
+   * @param model Whether to use model preprocessing (delta/MTF).
+   * @param bwt Whether to apply the Burrows-Wheeler transform before the
+   * model.
+   * @param entropy_mode Coding of the token fields.
+   * @param params Token parameters and the block size of adaptive mode.
+   */
+  Image(std::span<const uint8_t> data, uint32_t width, bool adaptive,
+        bool model, bool bwt, EntropyMode entropy_mode,
+        const CodecParams& params);
+
+  /**
+   * @brief Constructor for decoding a compressed image held in memory. Reads
+   * its header and seek table, throws if it is not a compressed image.
+   * @param compressed The compressed image.
+   */
+  explicit Image(std::span<const uint8_t> compressed);
+
+  /**
+   * @brief Constructor for encoding a band of rows of a stream. Bands are
+   * never palette packed.
+   * @param data The rows of the band.
+   * @param width Width of the image/data.
+   * @param height Number of rows of the band.
+   * @param adaptive Whether to use adaptive block strategy.
+   * @param model Whether to use model preprocessing (delta/MTF).
+   * @param bwt Whether to apply the Burrows-Wheeler transform before the
+   * model.
+   * @param entropy_mode Coding of the token fields.
+   * @param params Token parameters and the block size of adaptive mode.
+   */
+  Image(std::vector<uint8_t> data, uint32_t width, uint32_t height,
+        bool adaptive, bool model, bool bwt, EntropyMode entropy_mode,
+        const CodecParams& params);
+
+  /**
+   * @brief Constructor for decoding a band of rows of a stream.
+   * @param blocks The blocks of the band read from the stream.
+   * @param width Width of the image/data.
+   * @param height Number of rows of the band.
+   * @param adaptive Whether adaptive block strategy was used.
+   * @param model Whether model preprocessing was used.
+   * @param bwt Whether the Burrows-Wheeler transform was used.
+   * @param params Token parameters and the block size of the stream.
+   */
+  Image(std::vector<Block> blocks, uint32_t width, uint32_t height,
+        bool adaptive, bool model, bool bwt, const CodecParams& params);
+
   /**
    * @brief Destructor. Closes the output file handle if open.
    */
   ~Image();
 
   /**
-   * @brief Reads the compressed input file (header and blocks) for decoding.
+   * @brief Reads the header and seek table of the compressed input file for
+   * decoding, the blocks are read by decode_blocks.
    */
   void read_dec_input_file();
 
   /**
-   * @brief Reads the raw input file for encoding, calculating height based on
+   * @brief Maps the raw input file for encoding, calculating height based on
    * width.
    */
   void read_enc_input_file();
@@ -69,6 +135,20 @@ class Image {
    */
   void write_dec_output_file();
 
+  /**
+   * @brief Writes the composed data to a stream, unpacking palette indices
+   * first.
+   * @param stream The output stream.
+   * @return True if writing was successful, false otherwise.
+   */
+  bool write_data(std::ostream& stream);
+
+  /**
+   * @brief Hands the composed data over, unpacking palette indices first.
+   * @return The decoded pixels, of the region if one is set.
+   */
+  std::vector<uint8_t> release_data();
+
   /**
    * @brief Creates blocks from the loaded image data based on adaptive mode
    * setting.
@@ -87,19 +167,50 @@ class Image {
    */
   void encode_blocks();
 
+  /**
+   * @brief Encodes one of the created blocks. Different blocks may be
+   * encoded from several threads at once.
+   * @param index Index of the block.
+   * @param buffer Storage reused for the scanned pixels of the block.
+   */
+  void encode_block(size_t index, std::vector<uint8_t>& buffer);
+
+  /**
+   * @brief Releases the input once all the blocks are encoded.
+   */
+  void release_input();
+
   /**
    * @brief Writes the encoded blocks (including header) to the output file.
    */
   void write_blocks();
 
   /**
-   * @brief Decodes all loaded blocks, applying reverse model transformations
-   * and deserialization if needed.
+   * @brief Writes the encoded blocks (including header) to a stream. Throws
+   * if the stream fails.
+   * @param stream The output stream.
    */
-  void decode_blocks();
+  void write_blocks(std::ostream& stream);
 
   /**
-   * @brief Composes the final image data by assembling the decoded blocks.
+   * @brief Restricts decoding to a rectangle of the image, only the blocks
+   * intersecting it are read and decoded and only its pixels are written.
+   * Throws if the rectangle is empty or exceeds the image.
+   * @param region The rectangle in pixels of the original image.
+   */
+  void set_region(const Region& region);
+
+  /**
+   * @brief Decodes all blocks, applying reverse model transformations and
+   * deserialization if needed. Blocks of an input file are read and placed
+   * into the image by the worker threads as they are decoded.
+   * @param threads Number of worker threads, 0 for one per hardware thread.
+   */
+  void decode_blocks(unsigned threads = 1);
+
+  /**
+   * @brief Composes the final image data by assembling the decoded blocks,
+   * blocks of an input file are already in place.
    */
   void compose_image();
 
@@ -121,6 +232,12 @@ class Image {
    */
   bool is_adaptive();
 
+  /**
+   * @brief Gets the token parameters and the block size of the image.
+   * @return The parameters given when encoding or read from the header.
+   */
+  const CodecParams& get_params() const;
+
   /**
    * @brief Calculates and checks if the compression resulted in a smaller file
    * size. Prints stats.
@@ -128,6 +245,13 @@ class Image {
    */
   bool is_compression_successful();
 
+  /**
+   * @brief Calculates the size of the compressed image from the encoded
+   * blocks.
+   * @return Size of the written image in bytes.
+   */
+  size_t compressed_size() const;
+
   /**
    * @brief Applies the reverse delta transform to all blocks (used during
    * decoding if delta was applied).
@@ -141,6 +265,24 @@ class Image {
   void copy_unsuccessful_compression();
 
   private:
+  /**
+   * @brief Sets the pixels to encode, packing them by a palette if they have
+   * few colors.
+   * @param pixels The pixels of the image.
+   */
+  void load_pixels(std::span<const uint8_t> pixels);
+
+  /**
+   * @brief Copies the parameters from the header of the indexed input.
+   */
+  void load_index();
+
+  /**
+   * @brief Unpacks the palette indices of the composed data, only the region
+   * if one is set.
+   */
+  void unpack_data();
+
   /**
    * @brief Creates a single block containing the entire image data (used when
    * adaptive mode is off).
@@ -149,10 +291,47 @@ class Image {
 
   /**
    * @brief Creates multiple blocks by dividing the image data according to
-   * BLOCK_SIZE (used when adaptive mode is on).
+   * the block size (used when adaptive mode is on).
    */
   void create_multiple_blocks();
 
+  /**
+   * @brief Reverses the coding of a block, and its model and BWT if the BWT
+   * was used.
+   * @param block The block to decode.
+   */
+  void decode_block(Block& block);
+
+  /**
+   * @brief Writes the decoded data of a block into the composed image,
+   * reversing the model (unless the BWT was used) and the serialization in
+   * the same pass.
+   * @param block The decoded block.
+   * @param start_row Row of the image of the first block row.
+   * @param start_col Column of the image of the first block column.
+   */
+  void place_block(const Block& block, uint32_t start_row, uint32_t start_col);
+
+  /**
+   * @brief Reads, decodes and places the blocks of the input file, from
+   * several threads.
+   * @param threads Number of worker threads.
+   */
+  void decode_indexed_blocks(unsigned threads);
+
+  /**
+   * @brief Computes the rectangle of the coded data holding the region,
+   * packed pixels are covered by whole bytes.
+   * @return The rectangle, the whole image if no region is set.
+   */
+  Region coded_window() const;
+
+  /**
+   * @brief Unpacks the palette indices of the decoded window and keeps only
+   * the pixels of the region.
+   */
+  void unpack_region();
+
   private:
   std::string m_input_filename;
   std::string m_output_filename;
@@ -161,9 +340,17 @@ class Image {
   uint32_t m_height;
   bool m_adaptive;
   bool m_model;
+  bool m_bwt;
+  EntropyMode m_entropy_mode;
+  CodecParams m_params;  // token fields and the block size of adaptive mode
   std::vector<uint8_t> m_data;    // Holds raw data for encoding or decoded data
+  std::optional<MappedFile> m_input;  // mapping of the input when encoding
+  std::span<const uint8_t> m_pixels;  // data to encode, mapped or packed
+  std::optional<BlockIndex> m_index;  // blocks of the input when decoding
+  std::optional<Region> m_region;     // pixels to decode, all if empty
+  Region m_window;  // rectangle of the coded data held in m_data
   std::vector<token_t> m_tokens;  // Potentially unused if blocks hold tokens
-  bool m_binary_only;
+  Palette m_palette;  // bit depth and colors of packed data
 
   public:
   std::vector<Block> m_blocks;  // Holds the blocks for processing
@@ -14,39 +14,33 @@
 #include <assert.h>
 #include <math.h>
 
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <optional>
 #include <vector>
 
 #include "argparser.hpp"
+#include "batch.hpp"
+#include "block_writer.hpp"
 #include "image.hpp"
-
-uint16_t BLOCK_SIZE = DEFAULT_BLOCK_SIZE;
-
-// coded token parameters
-uint32_t OFFSET_BITS = DEFAULT_OFFSET_BITS;
-uint16_t LENGTH_BITS = DEFAULT_LENGTH_BITS;
-
-// max number expressible with the OFFSET_LENGTH bits
-uint16_t SEARCH_BUF_SIZE = (1 << OFFSET_BITS) - 1;
-
-// designates the max length in longest prefix searching
-// finds the maximum value we can represent with the given number of bits
-// and add the minimum coded length to optimize for value mapping
-uint16_t MAX_CODED_LEN = (1 << LENGTH_BITS) - 1 + MIN_CODED_LEN;
-
-// used only for statistics printing
-size_t TOKEN_CODED_LEN = 1 + OFFSET_BITS + LENGTH_BITS;
-size_t TOKEN_UNCODED_LEN = 1 + 8;
+#include "stream.hpp"
 
 void print_final_stats(Image& img) {
+  const CodecParams& params = img.get_params();
   size_t coded = 0;
   size_t uncoded = 0;
+  size_t coded_bits = 0;
   for (auto& block : img.m_blocks) {
     auto strategy = block.m_picked_strategy;
     for (auto& token : block.m_tokens[strategy]) {
-      token.coded ? coded++ : uncoded++;
+      if (token.coded) {
+        coded++;
+        coded_bits += token_size_bits(token, params);
+      } else {
+        uncoded++;
+      }
     }
   }
   size_t file_header_bits =
@@ -58,8 +52,7 @@ void print_final_stats(Image& img) {
     file_header_bits += 16;
   }
 
-  size_t total_token_bits =
-      (TOKEN_CODED_LEN * coded) + (TOKEN_UNCODED_LEN * uncoded);
+  size_t total_token_bits = coded_bits + (TOKEN_UNCODED_LEN * uncoded);
 
   size_t total_strategy_bits = img.m_blocks.size() * 2;
   size_t total_size_bits =
@@ -79,15 +72,16 @@ void print_final_stats(Image& img) {
   std::cout << "Adaptive Mode: " << (img.is_adaptive() ? "Yes" : "No")
             << std::endl;
   if (img.is_adaptive()) {
-    std::cout << "Block Size: " << BLOCK_SIZE << "x" << BLOCK_SIZE << std::endl;
+    std::cout << "Block Size: " << params.block_size << "x"
+              << params.block_size << std::endl;
   }
   std::cout << "Number of Blocks: " << img.m_blocks.size() << std::endl;
-  std::cout << "Offset Bits: " << OFFSET_BITS
-            << ", Length Bits: " << LENGTH_BITS << std::endl;
+  std::cout << "Offset Bits: " << params.offset_bits
+            << ", Length Bits: " << params.length_bits << std::endl;
   std::cout << "Original data size: " << size_original << "b ("
             << size_original / 8 << "B)" << std::endl;
-  std::cout << "Coded tokens: " << coded << " (" << TOKEN_CODED_LEN * coded
-            << "b)" << std::endl;
+  std::cout << "Coded tokens: " << coded << " (" << coded_bits << "b)"
+            << std::endl;
   std::cout << "Uncoded tokens: " << uncoded << " ("
             << TOKEN_UNCODED_LEN * uncoded << "b)" << std::endl;
   std::cout << "File Header Size: " << file_header_bits << "b" << std::endl;
@@ -109,53 +103,54 @@ void print_final_stats(Image& img) {
             << space_saved_percent << "%" << std::endl;
 }
 
-bool copy_uncompressed_file(std::string input_filename,
+bool copy_uncompressed_file(std::istream& input,
                             std::string output_filename) {
-  // open the input file in binary mode
-  std::ifstream i_file_handle(input_filename, std::ios::binary);
-
-  // read the first byte from the input file
-  char first_byte;
-  i_file_handle.get(first_byte);
-
-  if (first_byte) {
-    i_file_handle.close();
-
+  // the first byte tells whether the data were stored uncompressed
+  if (input.peek() != FORMAT_UNCOMPRESSED) {
     return false;
   }
+  input.get();
 
-  // open the output file
-  std::ifstream o_file_handle(output_filename, std::ios::binary);
-  // copy the contents of input file into the output file
+  // copy the rest of the input into the output file
   std::ofstream o_file_handle_copy(output_filename, std::ios::binary);
   if (!o_file_handle_copy) {
     throw std::runtime_error("Error: Unable to open output file: " +
                              output_filename);
   }
-  o_file_handle_copy << i_file_handle.rdbuf();
+  o_file_handle_copy << input.rdbuf();
   o_file_handle_copy.close();
-  i_file_handle.close();
   return true;
 }
 
 int main(int argc, char* argv[]) {
   ArgumentParser args(argc, argv);
-
-  SEARCH_BUF_SIZE = (1 << OFFSET_BITS) - 1;
-  MAX_CODED_LEN = (1 << LENGTH_BITS) - 1 + MIN_CODED_LEN;
-  TOKEN_CODED_LEN = 1 + OFFSET_BITS + LENGTH_BITS;
-  TOKEN_UNCODED_LEN = 1 + 8;
+  const CodecParams& params = args.get_params();
 
   // asserts for checking valid values
-  assert(BLOCK_SIZE > 0 && BLOCK_SIZE < (1 << 15));
-  assert(OFFSET_BITS > 0 && OFFSET_BITS < 32);
-  assert(LENGTH_BITS > 0 && LENGTH_BITS < 16);
+  assert(params.block_size > 0 && params.block_size < (1 << 15));
+  assert(params.offset_bits > 0 && params.offset_bits < 32);
+  assert(params.length_bits > 0 && params.length_bits < 16);
   assert(MIN_CODED_LEN > 0);
 
-  if (args.is_compress_mode()) {
+  if (args.is_batch()) {
+    return compress_batch(args.get_batch_file(), args.is_adaptive(),
+                          args.use_model(), args.use_bwt(),
+                          args.get_entropy_mode(), params,
+                          args.get_threads())
+               ? 0
+               : 1;
+  } else if (args.is_compress_mode() && args.is_streaming()) {
+    return compress_stream(args.get_input_file(), args.get_output_file(),
+                           args.get_image_width(), args.is_adaptive(),
+                           args.use_model(), args.use_bwt(),
+                           args.get_entropy_mode(), params)
+               ? 0
+               : 1;
+  } else if (args.is_compress_mode()) {
     Image i =
         Image(args.get_input_file(), args.get_output_file(),
-              args.get_image_width(), args.is_adaptive(), args.use_model());
+              args.get_image_width(), args.is_adaptive(), args.use_model(),
+              args.use_bwt(), args.get_entropy_mode(), params);
     i.create_blocks();
     i.encode_blocks();
     if (i.is_compression_successful()) {
@@ -165,11 +160,43 @@ int main(int argc, char* argv[]) {
       // print_final_stats(i);
     }
   } else {
-    if (copy_uncompressed_file(args.get_input_file(), args.get_output_file())) {
+    // the format byte is only peeked, copies and streams read on from here
+    std::ifstream input(args.get_input_file(), std::ios::binary);
+    if (!input) {
+      std::cerr << "Error: Unable to open input file: "
+                << args.get_input_file() << std::endl;
+      return 1;
+    }
+    // only images have a seek table locating the blocks of a region
+    std::optional<Region> region = args.get_region();
+    if (region && input.peek() != FORMAT_IMAGE) {
+      std::cerr << "Error: Only compressed images can be decoded by region."
+                << std::endl;
+      return 1;
+    }
+    if (copy_uncompressed_file(input, args.get_output_file())) {
       return 0;
     }
+    if (input.peek() == FORMAT_STREAM) {
+      return decompress_stream(input, args.get_output_file()) ? 0 : 1;
+    }
+    // whole images are mapped, which a pipe cannot be
+    input.close();
+    if (!std::filesystem::is_regular_file(args.get_input_file())) {
+      std::cerr << "Error: Only streams can be decompressed from a pipe."
+                << std::endl;
+      return 1;
+    }
     Image i = Image(args.get_input_file(), args.get_output_file());
-    i.decode_blocks();
+    if (region) {
+      try {
+        i.set_region(*region);
+      } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+      }
+    }
+    i.decode_blocks(args.get_threads());
     i.compose_image();
     i.write_dec_output_file();
   }
@@ -0,0 +1,70 @@
+/**
+ * @file      lzcodec.cpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Source file for the in-memory compression API of liblzcodec
+ *
+ * @date      12 April  2025 \n
+ */
+
+#include "lzcodec.hpp"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "image.hpp"
+
+namespace lzcodec {
+
+std::vector<uint8_t> compress(std::span<const uint8_t> data, uint32_t width,
+                              const CompressOptions& options) {
+  if (data.empty()) {
+    throw std::runtime_error("Error: No data to compress.");
+  }
+  Image image(data, width, options.adaptive, options.model, options.bwt,
+              options.entropy_mode, options.params);
+  image.create_blocks();
+  image.encode_blocks();
+
+  std::vector<uint8_t> output;
+  if (image.compressed_size() >= data.size()) {
+    // the data are stored as they are, like the command line tool does
+    output.reserve(data.size() + 1);
+    output.push_back(FORMAT_UNCOMPRESSED);
+    output.insert(output.end(), data.begin(), data.end());
+    return output;
+  }
+  std::ostringstream stream(std::ios::binary);
+  image.write_blocks(stream);
+  std::string_view bytes = stream.view();
+  output.assign(bytes.begin(), bytes.end());
+  return output;
+}
+
+std::vector<uint8_t> decompress(std::span<const uint8_t> data,
+                                const DecompressOptions& options) {
+  if (data.empty()) {
+    throw std::runtime_error("Error: No data to decompress.");
+  }
+  if (data[0] == FORMAT_UNCOMPRESSED) {
+    if (options.region) {
+      throw std::runtime_error(
+          "Error: Only compressed images can be decoded by region.");
+    }
+    return std::vector<uint8_t>(data.begin() + 1, data.end());
+  }
+  Image image(data);
+  if (options.region) {
+    image.set_region(*options.region);
+  }
+  image.decode_blocks(options.threads);
+  image.compose_image();
+  return image.release_data();
+}
+
+}  // namespace lzcodec
@@ -0,0 +1,76 @@
+/**
+ * @file      lzcodec.hpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Header file for the in-memory compression API of liblzcodec
+ *
+ * @date      12 April  2025 \n
+ */
+
+#ifndef LZCODEC_HPP
+#define LZCODEC_HPP
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "common.hpp"
+
+namespace lzcodec {
+
+/**
+ * @struct CompressOptions
+ * @brief Options of the compression, the counterparts of the -a, -m, -b and
+ * -e options and of the token parameters of the command line tool.
+ */
+struct CompressOptions {
+  bool adaptive = false;
+  bool model = false;
+  bool bwt = false;
+  EntropyMode entropy_mode = ENTROPY_HUFFMAN;
+  CodecParams params;
+};
+
+/**
+ * @struct DecompressOptions
+ * @brief Options of the decompression, the counterparts of the -t and --roi
+ * options of the command line tool.
+ */
+struct DecompressOptions {
+  unsigned threads = 1;  // 0 for one per hardware thread
+  std::optional<Region> region;
+};
+
+/**
+ * @brief Compresses an image into the format written by the command line
+ * tool. Data that do not compress are stored uncompressed behind a 0x00
+ * byte. Neither files nor the standard streams are used. Throws on invalid
+ * arguments.
+ * @param data The pixels of the image, row by row.
+ * @param width Width of the image, the size of the data must be a multiple
+ * of it.
+ * @param options Options of the compression.
+ * @return The compressed image.
+ */
+std::vector<uint8_t> compress(std::span<const uint8_t> data, uint32_t width,
+                              const CompressOptions& options = {});
+
+/**
+ * @brief Decompresses an image written by compress or by the command line
+ * tool (streams of bands are not supported). Neither files nor the standard
+ * streams are used. Throws on invalid or truncated data.
+ * @param data The compressed image.
+ * @param options Options of the decompression.
+ * @return The pixels of the image, or of the region, row by row.
+ */
+std::vector<uint8_t> decompress(std::span<const uint8_t> data,
+                                const DecompressOptions& options = {});
+
+}  // namespace lzcodec
+
+#endif  // LZCODEC_HPP
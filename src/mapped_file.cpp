@@ -0,0 +1,120 @@
+/**
+ * @file      mapped_file.cpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Source file for the read-only memory mapping of input files
+ *
+ * @date      12 April  2025 \n
+ */
+
+#include "mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+// rounds a length up to whole pages
+static size_t round_to_pages(size_t length, size_t page_size) {
+  return (length + page_size - 1) / page_size * page_size;
+}
+
+// reads the rest of a descriptor that cannot be mapped
+static void read_descriptor(int fd, size_t padding,
+                            std::vector<uint8_t>& bytes) {
+  size_t size = 0;
+  bytes.resize(1 << 16);
+  while (true) {
+    if (bytes.size() - size < (1 << 16)) {
+      bytes.resize(2 * bytes.size());
+    }
+    ssize_t n = read(fd, bytes.data() + size, bytes.size() - size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      throw std::runtime_error(std::string("Error: Unable to read input: ") +
+                               std::strerror(errno));
+    }
+    if (n == 0) {
+      break;
+    }
+    size += static_cast<size_t>(n);
+  }
+  bytes.resize(size);
+  bytes.resize(size + padding, 0);
+}
+
+MappedFile::MappedFile(const std::string& filename, size_t padding)
+    : m_data(nullptr), m_size(0), m_mapping(nullptr), m_mapping_length(0) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Error: Unable to open input file: " + filename);
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+    try {
+      read_descriptor(fd, padding, m_copy);
+    } catch (...) {
+      close(fd);
+      throw;
+    }
+    close(fd);
+    m_data = m_copy.data();
+    m_size = m_copy.size() - padding;
+    return;
+  }
+
+  // the padding past the last page of the file comes from an anonymous
+  // mapping the file is mapped over, so it reads as zeros and never faults
+  m_size = static_cast<size_t>(info.st_size);
+  size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  m_mapping_length = round_to_pages(m_size + padding, page_size);
+  m_mapping = mmap(nullptr, m_mapping_length, PROT_READ,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (m_mapping == MAP_FAILED ||
+      mmap(m_mapping, m_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) ==
+          MAP_FAILED) {
+    int error = errno;
+    if (m_mapping != MAP_FAILED) {
+      munmap(m_mapping, m_mapping_length);
+    }
+    m_mapping = nullptr;
+    close(fd);
+    throw std::runtime_error("Error: Unable to map input file: " + filename +
+                             ": " + std::strerror(error));
+  }
+  close(fd);
+
+  // the data is read once from the start to the end, the hints are advisory
+  madvise(m_mapping, m_size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+  madvise(m_mapping, m_size, MADV_HUGEPAGE);
+#endif
+  m_data = static_cast<const uint8_t*>(m_mapping);
+}
+
+MappedFile::MappedFile(std::span<const uint8_t> data, size_t padding)
+    : m_data(nullptr),
+      m_size(data.size()),
+      m_mapping(nullptr),
+      m_mapping_length(0) {
+  m_copy.reserve(data.size() + padding);
+  m_copy.assign(data.begin(), data.end());
+  m_copy.resize(data.size() + padding, 0);
+  m_data = m_copy.data();
+}
+
+MappedFile::~MappedFile() {
+  if (m_mapping != nullptr) {
+    munmap(m_mapping, m_mapping_length);
+  }
+}
@@ -0,0 +1,76 @@
+/**
+ * @file      mapped_file.hpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Header file for the read-only memory mapping of input files
+ *
+ * @date      12 April  2025 \n
+ */
+
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+/**
+ * @class MappedFile
+ * @brief Maps a whole input file read-only for a single sequential pass.
+ * Files that cannot be mapped (pipes, special files) are read into memory
+ * instead.
+ */
+class MappedFile {
+  public:
+  /**
+   * @brief Maps the file. Throws if it cannot be opened or read.
+   * @param filename Path to the file.
+   * @param padding Number of zero bytes that must be readable past the end
+   * of the data.
+   */
+  explicit MappedFile(const std::string& filename, size_t padding = 0);
+
+  /**
+   * @brief Copies data held in memory, which is then read like a file that
+   * could not be mapped.
+   * @param data The contents.
+   * @param padding Number of zero bytes that must be readable past the end
+   * of the data.
+   */
+  MappedFile(std::span<const uint8_t> data, size_t padding = 0);
+
+  /**
+   * @brief Destructor. Unmaps the file.
+   */
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /**
+   * @brief Gets the contents of the file.
+   * @return Pointer to the first byte, followed by the padding.
+   */
+  const uint8_t* data() const { return m_data; }
+
+  /**
+   * @brief Gets the size of the file.
+   * @return Size in bytes, without the padding.
+   */
+  size_t size() const { return m_size; }
+
+  private:
+  const uint8_t* m_data;
+  size_t m_size;
+  void* m_mapping;              // nullptr if the file was read instead
+  size_t m_mapping_length;      // length of the whole mapping
+  std::vector<uint8_t> m_copy;  // contents of a file that was not mapped
+};
+
+#endif  // MAPPED_FILE_HPP
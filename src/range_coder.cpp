@@ -0,0 +1,142 @@
+/**
+ * @file      range_coder.cpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Source file for the adaptive binary range coder of the coded
+ * flags
+ *
+ * @date      12 April  2025 \n
+ */
+
+#include "range_coder.hpp"
+
+#include <algorithm>
+#include <bit>
+
+static constexpr uint32_t RANGE_PROB_ONE = 1U << RANGE_PROB_BITS;
+// the range is renormalized by a byte once it drops below this
+static constexpr uint32_t RANGE_TOP = 1U << 24;
+
+FlagModel::FlagModel() : m_history(0), m_length_bucket(0) {
+  m_probabilities.fill(RANGE_PROB_ONE / 2);
+  m_row_probabilities.fill(RANGE_PROB_ONE / 2);
+  m_row_index_probabilities.fill(RANGE_PROB_ONE / 2);
+  m_rep_probabilities.fill(RANGE_PROB_ONE / 2);
+  m_slot_probabilities.fill(RANGE_PROB_ONE / 2);
+}
+
+uint16_t& FlagModel::probability() {
+  return m_probabilities[m_history * FLAG_LENGTH_BUCKETS + m_length_bucket];
+}
+
+void FlagModel::update(bool coded, uint16_t length) {
+  m_history = ((m_history << 1) | coded) & ((1U << FLAG_HISTORY_BITS) - 1);
+  if (coded) {
+    // length fields 0, 1-3, 4-15 and longer
+    m_length_bucket = std::min<uint32_t>((std::bit_width(length) + 1) / 2,
+                                         FLAG_LENGTH_BUCKETS - 1);
+  }
+}
+
+uint16_t& FlagModel::row_probability() {
+  return m_row_probabilities[m_history];
+}
+
+uint16_t& FlagModel::row_index_probability(size_t node) {
+  return m_row_index_probabilities[node];
+}
+
+uint16_t& FlagModel::rep_probability() {
+  return m_rep_probabilities[m_history];
+}
+
+uint16_t& FlagModel::slot_probability(size_t node) {
+  return m_slot_probabilities[node];
+}
+
+BinaryRangeEncoder::BinaryRangeEncoder()
+    : m_low(0),
+      m_range(UINT32_MAX),
+      m_cache(0),
+      m_cache_size(1),
+      m_leading(true) {}
+
+void BinaryRangeEncoder::shift_low() {
+  // emit the cached byte once no carry can reach it any more
+  if (static_cast<uint32_t>(m_low) < 0xFF000000U || (m_low >> 32) != 0) {
+    uint8_t carry = static_cast<uint8_t>(m_low >> 32);
+    uint8_t byte = m_cache;
+    do {
+      if (!m_leading) {
+        m_bytes.push_back(static_cast<uint8_t>(byte + carry));
+      }
+      m_leading = false;
+      byte = 0xFF;
+    } while (--m_cache_size != 0);
+    m_cache = static_cast<uint8_t>(m_low >> 24);
+  }
+  m_cache_size++;
+  m_low = (m_low & 0x00FFFFFFU) << 8;
+}
+
+void BinaryRangeEncoder::encode(uint16_t& probability, bool bit) {
+  uint32_t bound = (m_range >> RANGE_PROB_BITS) * probability;
+  if (!bit) {
+    m_range = bound;
+    probability += (RANGE_PROB_ONE - probability) >> RANGE_ADAPT_SHIFT;
+  } else {
+    m_low += bound;
+    m_range -= bound;
+    probability -= probability >> RANGE_ADAPT_SHIFT;
+  }
+  while (m_range < RANGE_TOP) {
+    m_range <<= 8;
+    shift_low();
+  }
+}
+
+std::vector<uint8_t> BinaryRangeEncoder::finish() {
+  for (int i = 0; i < 5; i++) {
+    shift_low();
+  }
+  // trailing zeros are implied by the decoder
+  while (!m_bytes.empty() && m_bytes.back() == 0) {
+    m_bytes.pop_back();
+  }
+  return m_bytes;
+}
+
+BinaryRangeDecoder::BinaryRangeDecoder(const std::vector<uint8_t>& bytes)
+    : m_bytes(bytes), m_position(0), m_code(0), m_range(UINT32_MAX) {
+  for (int i = 0; i < 4; i++) {
+    m_code = (m_code << 8) | next_byte();
+  }
+}
+
+uint8_t BinaryRangeDecoder::next_byte() {
+  return m_position < m_bytes.size() ? m_bytes[m_position++] : 0;
+}
+
+bool BinaryRangeDecoder::decode(uint16_t& probability) {
+  uint32_t bound = (m_range >> RANGE_PROB_BITS) * probability;
+  bool bit;
+  if (m_code < bound) {
+    m_range = bound;
+    probability += (RANGE_PROB_ONE - probability) >> RANGE_ADAPT_SHIFT;
+    bit = false;
+  } else {
+    m_code -= bound;
+    m_range -= bound;
+    probability -= probability >> RANGE_ADAPT_SHIFT;
+    bit = true;
+  }
+  while (m_range < RANGE_TOP) {
+    m_range <<= 8;
+    m_code = (m_code << 8) | next_byte();
+  }
+  return bit;
+}
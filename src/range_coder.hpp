@@ -0,0 +1,159 @@
+/**
+ * @file      range_coder.hpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Header file for the adaptive binary range coder of the coded
+ * flags
+ *
+ * @date      12 April  2025 \n
+ */
+
+#ifndef RANGE_CODER_HPP
+#define RANGE_CODER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "token.hpp"
+
+// probabilities of a zero bit are kept in RANGE_PROB_BITS bits and move by
+// 1 / 2^RANGE_ADAPT_SHIFT of the distance to the coded bit
+#define RANGE_PROB_BITS 11
+#define RANGE_ADAPT_SHIFT 5
+
+// the flag context is the last two flags and the bucket of the last length
+#define FLAG_HISTORY_BITS 2
+#define FLAG_LENGTH_BUCKETS 4
+// bits of the index of a row offset
+#define ROW_INDEX_BITS 2
+
+/**
+ * @class FlagModel
+ * @brief Adaptive probabilities of the coded flag, selected by the previous
+ * flags and the previous match length, and of the rep slots of coded tokens.
+ */
+class FlagModel {
+  public:
+  FlagModel();
+
+  /**
+   * @brief Gets the probability of the current context.
+   * @return Probability of an uncoded token, updated by the coder.
+   */
+  uint16_t& probability();
+
+  /**
+   * @brief Moves the context past a token.
+   * @param coded Flag of the token.
+   * @param length Length field of the token if it is coded.
+   */
+  void update(bool coded, uint16_t length);
+
+  /**
+   * @brief Gets the probability that a coded token copies from the previous
+   * row, selected by the previous flags.
+   * @return Probability of any other offset, updated by the coder.
+   */
+  uint16_t& row_probability();
+
+  /**
+   * @brief Gets the probability of a bit of the row offset index (stride
+   * minus one, stride, stride plus one), coded as a binary tree.
+   * @param node Tree node of the bit, 1 for the first one.
+   * @return Probability of a zero bit, updated by the coder.
+   */
+  uint16_t& row_index_probability(size_t node);
+
+  /**
+   * @brief Gets the probability that a coded token refers to a rep slot,
+   * selected by the previous flags.
+   * @return Probability of a new offset, updated by the coder.
+   */
+  uint16_t& rep_probability();
+
+  /**
+   * @brief Gets the probability of a bit of the rep slot, coded most
+   * significant bit first as a binary tree.
+   * @param node Tree node of the bit, 1 for the first one.
+   * @return Probability of a zero bit, updated by the coder.
+   */
+  uint16_t& slot_probability(size_t node);
+
+  private:
+  std::array<uint16_t, (1 << FLAG_HISTORY_BITS) * FLAG_LENGTH_BUCKETS>
+      m_probabilities;
+  std::array<uint16_t, 1 << FLAG_HISTORY_BITS> m_row_probabilities;
+  std::array<uint16_t, 1 << ROW_INDEX_BITS> m_row_index_probabilities;
+  std::array<uint16_t, 1 << FLAG_HISTORY_BITS> m_rep_probabilities;
+  std::array<uint16_t, REP_OFFSETS> m_slot_probabilities;
+  uint32_t m_history;
+  uint32_t m_length_bucket;
+};
+
+/**
+ * @class BinaryRangeEncoder
+ * @brief Carry-propagating range encoder of adaptively modelled bits.
+ */
+class BinaryRangeEncoder {
+  public:
+  BinaryRangeEncoder();
+
+  /**
+   * @brief Encodes a bit and adapts its probability.
+   * @param probability Probability of a zero bit.
+   * @param bit The bit.
+   */
+  void encode(uint16_t& probability, bool bit);
+
+  /**
+   * @brief Flushes the coder.
+   * @return The coded bytes.
+   */
+  std::vector<uint8_t> finish();
+
+  private:
+  void shift_low();
+
+  uint64_t m_low;
+  uint32_t m_range;
+  uint8_t m_cache;
+  size_t m_cache_size;
+  bool m_leading;  // the first byte is always zero and is not stored
+  std::vector<uint8_t> m_bytes;
+};
+
+/**
+ * @class BinaryRangeDecoder
+ * @brief Decodes bits of a BinaryRangeEncoder, reading zeros past the end.
+ */
+class BinaryRangeDecoder {
+  public:
+  /**
+   * @brief Initializes the code from the start of the bytes.
+   * @param bytes The coded bytes.
+   */
+  explicit BinaryRangeDecoder(const std::vector<uint8_t>& bytes);
+
+  /**
+   * @brief Decodes a bit and adapts its probability.
+   * @param probability Probability of a zero bit.
+   * @return The bit.
+   */
+  bool decode(uint16_t& probability);
+
+  private:
+  uint8_t next_byte();
+
+  const std::vector<uint8_t>& m_bytes;
+  size_t m_position;
+  uint32_t m_code;
+  uint32_t m_range;
+};
+
+#endif  // RANGE_CODER_HPP
@@ -0,0 +1,146 @@
+/**
+ * @file      rans.cpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Source file for the interleaved static rANS coder of the token
+ * fields
+ *
+ * @date      12 April  2025 \n
+ */
+
+#include "rans.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+// states live in [RANS_LOWER_BOUND, 2^32) and are renormalized by 16 bits
+static constexpr uint32_t RANS_LOWER_BOUND = 1U << 16;
+static constexpr uint32_t RANS_TOTAL = 1U << RANS_SCALE_BITS;
+
+std::vector<uint32_t> rans_normalize_frequencies(
+    const std::vector<size_t>& counts) {
+  std::vector<uint32_t> frequencies(counts.size(), 0);
+  size_t total = std::accumulate(counts.begin(), counts.end(), size_t{0});
+  if (total == 0) {
+    return frequencies;
+  }
+
+  size_t sum = 0;
+  for (size_t symbol = 0; symbol < counts.size(); symbol++) {
+    if (counts[symbol] != 0) {
+      frequencies[symbol] = static_cast<uint32_t>(
+          std::max<size_t>(1, counts[symbol] * RANS_TOTAL / total));
+      sum += frequencies[symbol];
+    }
+  }
+  // the rounding error goes to (or comes from) the most frequent symbols
+  while (sum != RANS_TOTAL) {
+    auto largest = std::max_element(frequencies.begin(), frequencies.end());
+    if (sum < RANS_TOTAL) {
+      *largest += static_cast<uint32_t>(RANS_TOTAL - sum);
+      sum = RANS_TOTAL;
+    } else {
+      (*largest)--;
+      sum--;
+    }
+  }
+  return frequencies;
+}
+
+RansTable::RansTable(const std::vector<uint32_t>& frequencies)
+    : m_frequencies(frequencies),
+      m_starts(frequencies.size(), 0),
+      m_slot_symbols(RANS_TOTAL, 0) {
+  uint64_t sum = 0;
+  for (size_t symbol = 0; symbol < frequencies.size(); symbol++) {
+    m_starts[symbol] = static_cast<uint32_t>(sum);
+    sum += frequencies[symbol];
+    if (sum > RANS_TOTAL) {
+      break;
+    }
+    std::fill(m_slot_symbols.begin() + m_starts[symbol],
+              m_slot_symbols.begin() + sum, static_cast<uint16_t>(symbol));
+  }
+  if (sum != 0 && sum != RANS_TOTAL) {
+    throw std::runtime_error("rANS Error: Frequencies are not normalized.");
+  }
+}
+
+void RansEncoder::put(const RansTable& table, uint16_t symbol) {
+  m_symbols.push_back({table.m_starts[symbol], table.m_frequencies[symbol]});
+}
+
+std::vector<uint16_t> RansEncoder::finish() const {
+  std::array<uint32_t, RANS_STREAMS> states;
+  states.fill(RANS_LOWER_BOUND);
+  std::vector<uint16_t> words;
+  words.reserve(m_symbols.size() / 2 + 2 * RANS_STREAMS);
+
+  // the decoder runs forwards, so the symbols are coded from the last one
+  for (size_t i = m_symbols.size(); i-- > 0;) {
+    uint32_t& state = states[i % RANS_STREAMS];
+    const Symbol& symbol = m_symbols[i];
+    // keep the coded state below 2^32
+    uint64_t state_max =
+        (static_cast<uint64_t>(RANS_LOWER_BOUND >> RANS_SCALE_BITS) << 16) *
+        symbol.frequency;
+    if (state >= state_max) {
+      words.push_back(static_cast<uint16_t>(state));
+      state >>= 16;
+    }
+    state = ((state / symbol.frequency) << RANS_SCALE_BITS) +
+            (state % symbol.frequency) + symbol.start;
+  }
+
+  // the final states are the first words the decoder reads
+  for (size_t stream = RANS_STREAMS; stream-- > 0;) {
+    words.push_back(static_cast<uint16_t>(states[stream]));
+    words.push_back(static_cast<uint16_t>(states[stream] >> 16));
+  }
+  std::reverse(words.begin(), words.end());
+  return words;
+}
+
+RansDecoder::RansDecoder(const std::vector<uint16_t>& words)
+    : m_words(words),
+      m_position(0),
+      m_next_stream(0),
+      m_valid(words.size() >= 2 * RANS_STREAMS) {
+  m_states.fill(RANS_LOWER_BOUND);
+  if (!m_valid) {
+    return;
+  }
+  for (auto& state : m_states) {
+    state = (static_cast<uint32_t>(m_words[m_position]) << 16) |
+            m_words[m_position + 1];
+    m_position += 2;
+  }
+}
+
+bool RansDecoder::get(const RansTable& table, uint16_t& symbol) {
+  uint32_t& state = m_states[m_next_stream];
+  m_next_stream = (m_next_stream + 1) % RANS_STREAMS;
+
+  uint32_t slot = state & (RANS_TOTAL - 1);
+  symbol = table.m_slot_symbols[slot];
+  uint32_t frequency = symbol < table.m_frequencies.size()
+                           ? table.m_frequencies[symbol]
+                           : 0;
+  if (!m_valid || frequency == 0) {
+    return false;
+  }
+  state = frequency * (state >> RANS_SCALE_BITS) + slot -
+          table.m_starts[symbol];
+  if (state < RANS_LOWER_BOUND) {
+    if (m_position >= m_words.size()) {
+      return false;
+    }
+    state = (state << 16) | m_words[m_position++];
+  }
+  return true;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file      rans.hpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Header file for the interleaved static rANS coder of the token
+ * fields
+ *
+ * @date      12 April  2025 \n
+ */
+
+#ifndef RANS_HPP
+#define RANS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// frequencies of every alphabet are normalized to sum to 1 << RANS_SCALE_BITS
+#define RANS_SCALE_BITS 12
+// number of interleaved states, symbol i is coded by state i % RANS_STREAMS
+#define RANS_STREAMS 4
+
+/**
+ * @brief Scales symbol counts to frequencies summing to 1 << RANS_SCALE_BITS,
+ * keeping every used symbol at least 1.
+ * @param counts Number of occurrences of every symbol.
+ * @return Normalized frequencies, all zero if no symbol occurs.
+ */
+std::vector<uint32_t> rans_normalize_frequencies(
+    const std::vector<size_t>& counts);
+
+/**
+ * @class RansTable
+ * @brief Cumulative frequencies of an alphabet and the slot lookup used by the
+ * decoder.
+ */
+class RansTable {
+  public:
+  /**
+   * @brief Builds the table. Throws if the frequencies do not sum to
+   * 1 << RANS_SCALE_BITS (unless they are all zero).
+   * @param frequencies Normalized frequency of every symbol.
+   */
+  explicit RansTable(const std::vector<uint32_t>& frequencies);
+
+  std::vector<uint32_t> m_frequencies;
+  std::vector<uint32_t> m_starts;
+  std::vector<uint16_t> m_slot_symbols;  // symbol owning every slot
+};
+
+/**
+ * @class RansEncoder
+ * @brief Collects symbols in stream order and encodes them backwards with
+ * RANS_STREAMS interleaved 32-bit states emitting 16-bit words.
+ */
+class RansEncoder {
+  public:
+  /**
+   * @brief Appends a symbol to the stream.
+   * @param table Table of the symbol's alphabet.
+   * @param symbol The symbol, it must have a non-zero frequency.
+   */
+  void put(const RansTable& table, uint16_t symbol);
+
+  /**
+   * @brief Encodes the collected symbols.
+   * @return Words in the order the decoder reads them, starting with the
+   * final states.
+   */
+  std::vector<uint16_t> finish() const;
+
+  private:
+  struct Symbol {
+    uint32_t start;
+    uint32_t frequency;
+  };
+  std::vector<Symbol> m_symbols;
+};
+
+/**
+ * @class RansDecoder
+ * @brief Decodes symbols from the words of a RansEncoder, keeping all the
+ * interleaved states in flight.
+ */
+class RansDecoder {
+  public:
+  /**
+   * @brief Initializes the states from the start of the words.
+   * @param words The encoded words.
+   */
+  explicit RansDecoder(const std::vector<uint16_t>& words);
+
+  /**
+   * @brief Decodes the next symbol of the stream.
+   * @param table Table of the symbol's alphabet.
+   * @param symbol The decoded symbol.
+   * @return False if the words are exhausted or corrupted.
+   */
+  bool get(const RansTable& table, uint16_t& symbol);
+
+  private:
+  const std::vector<uint16_t>& m_words;
+  size_t m_position;
+  size_t m_next_stream;
+  std::array<uint32_t, RANS_STREAMS> m_states;
+  bool m_valid;
+};
+
+#endif  // RANS_HPP
@@ -0,0 +1,157 @@
+/**
+ * @file      stream.cpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Source file for the compression of unbounded streams in bands of
+ * rows
+ *
+ * @date      12 April  2025 \n
+ */
+
+#include "stream.hpp"
+
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "block_reader.hpp"
+#include "block_writer.hpp"
+#include "image.hpp"
+
+// reads up to the given number of bytes, fewer only at the end of the input
+static std::vector<uint8_t> read_band_data(std::istream& input, size_t size) {
+  std::vector<uint8_t> data(size);
+  input.read(reinterpret_cast<char*>(data.data()),
+             static_cast<std::streamsize>(size));
+  data.resize(static_cast<size_t>(input.gcount()));
+  return data;
+}
+
+bool compress_stream(const std::string& input_filename,
+                     const std::string& output_filename, uint32_t width,
+                     bool adaptive, bool model, bool bwt,
+                     EntropyMode entropy_mode, const CodecParams& params) {
+  if (width == 0) {
+    std::cerr << "Error: Image width must be positive." << std::endl;
+    return false;
+  }
+  std::ifstream input(input_filename, std::ios::binary);
+  if (!input) {
+    std::cerr << "Error: Unable to open input file: " << input_filename
+              << std::endl;
+    return false;
+  }
+  std::ofstream output(output_filename, std::ios::binary);
+  if (!output) {
+    std::cerr << "Error opening file for writing: " << output_filename
+              << std::endl;
+    return false;
+  }
+
+  try {
+    if (!write_stream_header(output, width, params, adaptive, model, bwt,
+                             entropy_mode)) {
+      throw std::runtime_error("Failed to write header.");
+    }
+
+    size_t band_size = static_cast<size_t>(width) * params.block_size;
+    auto read_next = [&input, band_size]() {
+      return read_band_data(input, band_size);
+    };
+    std::future<std::vector<uint8_t>> next =
+        std::async(std::launch::async, read_next);
+    uint64_t original_size = 0;
+    while (true) {
+      std::vector<uint8_t> data = next.get();
+      if (data.empty()) {
+        break;
+      }
+      if (data.size() % width != 0) {
+        throw std::runtime_error(
+            "Input size is not a multiple of the image width.");
+      }
+      // the next band is read while this one is encoded
+      next = std::async(std::launch::async, read_next);
+
+      original_size += data.size();
+      uint32_t rows = static_cast<uint32_t>(data.size() / width);
+      Image band(std::move(data), width, rows, adaptive, model, bwt,
+                 entropy_mode, params);
+      band.create_blocks();
+      band.encode_blocks();
+      if (!write_stream_band(output, rows, params, adaptive, bwt,
+                             entropy_mode, band.m_blocks)) {
+        throw std::runtime_error("Failed to write band.");
+      }
+    }
+    if (!write_stream_end(output)) {
+      throw std::runtime_error("Failed to write the end of the stream.");
+    }
+
+    // pipes have no position to report the size by
+    std::streamoff compressed_size = output.tellp();
+    std::cout << "Original Size: " << original_size << " bytes" << std::endl;
+    if (compressed_size >= 0) {
+      std::cout << "Compressed Size: " << compressed_size << " bytes"
+                << std::endl;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "Error during stream compression: " << e.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool decompress_stream(std::istream& input,
+                       const std::string& output_filename) {
+  uint32_t width;
+  bool adaptive, model, bwt;
+  EntropyMode entropy_mode;
+  CodecParams params;
+  if (!read_stream_header(input, width, params, adaptive, model, bwt,
+                          entropy_mode)) {
+    return false;
+  }
+  std::ofstream output(output_filename, std::ios::binary);
+  if (!output) {
+    std::cerr << "Error opening file for writing: " << output_filename
+              << std::endl;
+    return false;
+  }
+
+  try {
+    uint64_t written = 0;
+    while (true) {
+      uint32_t rows;
+      std::vector<Block> blocks;
+      if (!read_stream_band(input, width, params, adaptive, bwt, entropy_mode,
+                            rows, blocks)) {
+        return false;
+      }
+      if (rows == 0) {
+        break;
+      }
+      Image band(std::move(blocks), width, rows, adaptive, model, bwt,
+                 params);
+      band.decode_blocks();
+      band.compose_image();
+      if (!band.write_data(output)) {
+        throw std::runtime_error("Failed to write band.");
+      }
+      written += static_cast<uint64_t>(width) * rows;
+    }
+    std::cout << "Decoded data written to: " << output_filename << std::endl;
+    std::cout << "Written " << written << " bytes." << std::endl;
+  } catch (const std::exception& e) {
+    std::cerr << "Error during stream decompression: " << e.what()
+              << std::endl;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file      stream.hpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Header file for the compression of unbounded streams in bands of
+ * rows
+ *
+ * @date      12 April  2025 \n
+ */
+
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+#include <cstdint>
+#include <istream>
+#include <string>
+
+#include "common.hpp"
+
+/**
+ * @brief Compresses an input of any length in bands of block size rows. The
+ * next band is read while the current one is encoded, and every band is
+ * written as soon as it is encoded.
+ * @param input_filename Path to the input, may be a pipe.
+ * @param output_filename Path to the output, may be a pipe.
+ * @param width Width of the image/data.
+ * @param adaptive Whether to split the bands into blocks of block size
+ * columns with the adaptive strategy.
+ * @param model Whether to use model preprocessing (delta/MTF).
+ * @param bwt Whether to apply the Burrows-Wheeler transform before the model.
+ * @param entropy_mode Coding of the token fields.
+ * @param params Token parameters and the block size, the height of a band.
+ * @return True if the whole input was compressed, false otherwise.
+ */
+bool compress_stream(const std::string& input_filename,
+                     const std::string& output_filename, uint32_t width,
+                     bool adaptive, bool model, bool bwt,
+                     EntropyMode entropy_mode, const CodecParams& params);
+
+/**
+ * @brief Decompresses a stream written by compress_stream band by band.
+ * @param input The compressed input, positioned at its start.
+ * @param output_filename Path to the output, may be a pipe.
+ * @return True if the whole stream was decompressed, false otherwise.
+ */
+bool decompress_stream(std::istream& input, const std::string& output_filename);
+
+#endif  // STREAM_HPP
@@ -0,0 +1,84 @@
+/**
+ * @file      thread_pool.cpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Source file for the thread pool running the tasks of a batch
+ *
+ * @date      12 April  2025 \n
+ */
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+ThreadPool::ThreadPool(unsigned threads) : m_running(0), m_stopping(false) {
+  if (threads == 0) {
+    threads = std::max(1U, std::thread::hardware_concurrency());
+  }
+  m_workers.reserve(threads);
+  for (unsigned t = 0; t < threads; t++) {
+    m_workers.emplace_back(&ThreadPool::work, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  wait();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_task_ready.notify_all();
+  for (auto& worker : m_workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::submit(Task task, bool urgent) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (urgent) {
+      m_tasks.push_front(std::move(task));
+    } else {
+      m_tasks.push_back(std::move(task));
+    }
+  }
+  m_task_ready.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_idle.wait(lock, [this]() { return m_tasks.empty() && m_running == 0; });
+}
+
+unsigned ThreadPool::size() const {
+  return static_cast<unsigned>(m_workers.size());
+}
+
+void ThreadPool::work() {
+  WorkerContext context;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_task_ready.wait(lock,
+                      [this]() { return m_stopping || !m_tasks.empty(); });
+    if (m_tasks.empty()) {
+      return;
+    }
+    Task task = std::move(m_tasks.front());
+    m_tasks.pop_front();
+    m_running++;
+    lock.unlock();
+    task(context);
+    // the task is destroyed before the pool may report being idle
+    task = nullptr;
+    lock.lock();
+    m_running--;
+    if (m_tasks.empty() && m_running == 0) {
+      m_idle.notify_all();
+    }
+  }
+}
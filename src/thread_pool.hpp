@@ -0,0 +1,93 @@
+/**
+ * @file      thread_pool.hpp
+ *
+ * @author    Pavel Kratochvil \n
+ *            Faculty of Information Technology \n
+ *            Brno University of Technology \n
+ *            xkrato61@fit.vutbr.cz
+ *
+ * @brief     Header file for the thread pool running the tasks of a batch
+ *
+ * @date      12 April  2025 \n
+ */
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @struct WorkerContext
+ * @brief State a worker keeps between its tasks, the buffer the pixels of a
+ * block are scanned into is reused by every block the worker encodes.
+ */
+struct WorkerContext {
+  std::vector<uint8_t> buffer;
+};
+
+// a task of the pool, run with the context of the worker taking it
+using Task = std::function<void(WorkerContext&)>;
+
+/**
+ * @class ThreadPool
+ * @brief Fixed number of workers taking tasks from one queue. Urgent tasks
+ * are taken before the others, so the work a task spawns runs before the
+ * tasks queued earlier.
+ */
+class ThreadPool {
+  public:
+  /**
+   * @brief Starts the workers.
+   * @param threads Number of workers, 0 for one per hardware thread.
+   */
+  explicit ThreadPool(unsigned threads);
+
+  /**
+   * @brief Destructor. Waits for all the tasks and stops the workers.
+   */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   * @brief Queues a task, it may be submitted from another task. Tasks must
+   * not throw.
+   * @param task The task.
+   * @param urgent Whether the task goes to the front of the queue.
+   */
+  void submit(Task task, bool urgent = false);
+
+  /**
+   * @brief Waits until the queue is empty and no task is running.
+   */
+  void wait();
+
+  /**
+   * @brief Gets the number of workers.
+   * @return Number of worker threads.
+   */
+  unsigned size() const;
+
+  private:
+  /**
+   * @brief Runs the tasks of the queue until the pool is stopped.
+   */
+  void work();
+
+  std::deque<Task> m_tasks;
+  std::mutex m_mutex;
+  std::condition_variable m_task_ready;  // a task was queued or stopping
+  std::condition_variable m_idle;        // the queue ran empty
+  size_t m_running;                      // tasks being run
+  bool m_stopping;
+  std::vector<std::thread> m_workers;
+};
+
+#endif  // THREAD_POOL_HPP
@@ -14,6 +14,7 @@
 #ifndef TOKEN_HPP
 #define TOKEN_HPP
 
+#include <array>
 #include <cstdint>
 #include <fstream>
 #include <iostream>
@@ -39,4 +40,52 @@ typedef struct {
 
 } token_t;
 
+// number of recently used offsets a coded token can refer to by a slot index
+#define REP_SLOT_BITS 2
+#define REP_OFFSETS (1 << REP_SLOT_BITS)
+// coded tokens copying from the previous row of the block (offsets of the row
+// stride minus one, the stride and the stride plus one) have their own codes
+#define ROW_OFFSETS 3
+
+/**
+ * @class RepOffsets
+ * @brief Offsets of the last coded tokens of a block, most recent first. The
+ * encoder and the decoder update it after every coded token.
+ */
+class RepOffsets {
+  public:
+  RepOffsets() { m_offsets.fill(0); }
+
+  /**
+   * @brief Looks an offset up.
+   * @param offset The offset.
+   * @return Its slot, -1 if it was not used recently.
+   */
+  int find(uint16_t offset) const {
+    for (int slot = 0; slot < REP_OFFSETS; slot++) {
+      if (m_offsets[slot] == offset) {
+        return slot;
+      }
+    }
+    return -1;
+  }
+
+  /**
+   * @brief Moves an offset to the front, dropping the oldest one if it is new.
+   * @param offset Offset of the coded token.
+   */
+  void update(uint16_t offset) {
+    int slot = find(offset);
+    for (int i = slot < 0 ? REP_OFFSETS - 1 : slot; i > 0; i--) {
+      m_offsets[i] = m_offsets[i - 1];
+    }
+    m_offsets[0] = offset;
+  }
+
+  uint16_t operator[](int slot) const { return m_offsets[slot]; }
+
+  private:
+  std::array<uint16_t, REP_OFFSETS> m_offsets;
+};
+
 #endif  // TOKEN_HPP
\ No newline at end of file
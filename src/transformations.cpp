@@ -15,112 +15,273 @@
 #include "transformations.hpp"
 
 #include <algorithm>
+#include <bit>
+#include <cstring>
 #include <numeric>
 #include <stdexcept>
 
-void binary_only_pack(std::vector<uint8_t>& data, uint32_t& m_width,
-                      uint32_t& m_height, uint64_t& expected_size) {
-  // compress eights of bytes in m_data into one byte
-  std::vector<uint8_t> compressed_data;
-  compressed_data.reserve(data.size() / 8);
-  for (size_t i = 0; i < data.size(); i += 8) {
-    uint8_t packed_byte = 0;
-    for (size_t j = 0; j < 8 && i + j < data.size(); ++j) {
-      if (data[i + j] == 0xFF) {
-        packed_byte |= (1 << (7 - j));
+#include "common.hpp"
+
+#if USE_SIMD && (defined(__AVX2__) || defined(__SSE2__))
+#include <immintrin.h>
+#endif
+
+bool build_palette(const uint8_t* data, size_t size, Palette& palette) {
+  bool seen[256] = {};
+  std::vector<uint8_t> colors;
+  colors.reserve(MAX_PALETTE_SIZE + 1);
+  size_t i = 0;
+#if USE_SIMD && defined(__SSE2__)
+  // compare whole vectors against the colors found so far and fall back to
+  // the bytes only for the lanes no color matched
+  __m128i known[MAX_PALETTE_SIZE];
+  for (; i + 16 <= size; i += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    __m128i hits = _mm_setzero_si128();
+    for (size_t k = 0; k < colors.size(); k++) {
+      hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, known[k]));
+    }
+    uint32_t misses =
+        ~static_cast<uint32_t>(_mm_movemask_epi8(hits)) & UINT16_MAX;
+    while (misses != 0) {
+      if (colors.size() == MAX_PALETTE_SIZE) {
+        return false;
       }
+      uint8_t value = data[i + std::countr_zero(misses)];
+      known[colors.size()] = _mm_set1_epi8(static_cast<char>(value));
+      misses &= ~static_cast<uint32_t>(
+          _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, known[colors.size()])));
+      seen[value] = true;
+      colors.push_back(value);
     }
-    compressed_data.push_back(packed_byte);
   }
-  data.clear();
-  data.shrink_to_fit();
-  data = compressed_data;
-  if (m_width == 1) {
-    m_height = (m_height + 7) / 8;
-    expected_size = m_height;
+#endif
+  for (; i < size; i++) {
+    if (!seen[data[i]]) {
+      if (colors.size() == MAX_PALETTE_SIZE) {
+        return false;
+      }
+      seen[data[i]] = true;
+      colors.push_back(data[i]);
+    }
+  }
+
+  std::sort(colors.begin(), colors.end());
+  palette.colors = colors;
+  if (colors.size() <= 2) {
+    palette.bits_per_pixel = 1;
+  } else if (colors.size() <= 4) {
+    palette.bits_per_pixel = 2;
   } else {
-    expected_size = (static_cast<uint64_t>(m_width) * m_height + 7) / 8;
-    m_width = (m_width + 7) / 8;
+    palette.bits_per_pixel = 4;
   }
+  return true;
 }
 
-void binary_only_unpack(std::vector<uint8_t>& data) {
-  std::vector<uint8_t> decompressed_data;
-  bool finished_unpacking = false;
+size_t packed_row_size(size_t n_pixels, uint8_t bits_per_pixel) {
+  return (n_pixels * bits_per_pixel + 7) / 8;
+}
 
-  for (uint8_t compressed_byte : data) {
-    if (finished_unpacking)
-      break;
-    for (int j = 7; j >= 0; --j) {
-      if ((compressed_byte >> j) & 1) {
-        decompressed_data.push_back(0xFF);
-      } else {
-        decompressed_data.push_back(0x00);
-      }
+// packs one row of pixels into palette indices
+static void pack_row(const uint8_t* src, size_t n_pixels, uint8_t* dst,
+                     const Palette& palette, const uint8_t* index_of) {
+  const uint8_t bits = palette.bits_per_pixel;
+  size_t i = 0;
+  size_t o = 0;
+#if USE_SIMD && defined(__SSSE3__)
+  // the colors are sorted, so the index of a pixel is the number of colors
+  // above the first one it is not smaller than
+  __m128i colors[MAX_PALETTE_SIZE];
+  for (size_t k = 1; k < palette.colors.size(); k++) {
+    colors[k] = _mm_set1_epi8(static_cast<char>(palette.colors[k]));
+  }
+  for (; i + 16 <= n_pixels; i += 16) {
+    __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i indices = _mm_setzero_si128();
+    for (size_t k = 1; k < palette.colors.size(); k++) {
+      __m128i not_below =
+          _mm_cmpeq_epi8(_mm_max_epu8(pixels, colors[k]), pixels);
+      indices = _mm_sub_epi8(indices, not_below);
+    }
+    if (bits == 1) {
+      uint16_t packed = static_cast<uint16_t>(
+          _mm_movemask_epi8(_mm_slli_epi16(indices, 7)));
+      std::memcpy(dst + o, &packed, sizeof(packed));
+    } else if (bits == 2) {
+      __m128i pairs = _mm_maddubs_epi16(indices, _mm_set1_epi16(0x0401));
+      __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00100001));
+      __m128i bytes = _mm_shuffle_epi8(
+          quads, _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                               -1, -1, -1));
+      uint32_t packed = static_cast<uint32_t>(_mm_cvtsi128_si32(bytes));
+      std::memcpy(dst + o, &packed, sizeof(packed));
+    } else {
+      __m128i pairs = _mm_maddubs_epi16(indices, _mm_set1_epi16(0x1001));
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + o),
+                       _mm_packus_epi16(pairs, pairs));
     }
+    o += 2 * bits;
+  }
+#endif
+  const size_t pixels_per_byte = 8 / bits;
+  for (; i < n_pixels; i += pixels_per_byte) {
+    uint8_t packed_byte = 0;
+    for (size_t j = 0; j < pixels_per_byte && i + j < n_pixels; j++) {
+      packed_byte |= index_of[src[i + j]] << (j * bits);
+    }
+    dst[o++] = packed_byte;
   }
-
-  data = decompressed_data;
 }
 
-void rle(std::vector<uint8_t>& data) {
-  if (data.empty()) {
-    return;
+#if USE_SIMD && defined(__SSSE3__)
+// looks up the pixels of 16 nibbles, each holding 4 / bits_per_pixel indices
+static void expand_nibbles(__m128i nibbles, const __m128i* tables,
+                           size_t pixels_per_nibble, uint8_t* dst) {
+  auto store = [&](size_t at, __m128i pixels) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + at), pixels);
+  };
+  if (pixels_per_nibble == 1) {
+    store(0, _mm_shuffle_epi8(tables[0], nibbles));
+  } else if (pixels_per_nibble == 2) {
+    __m128i even = _mm_shuffle_epi8(tables[0], nibbles);
+    __m128i odd = _mm_shuffle_epi8(tables[1], nibbles);
+    store(0, _mm_unpacklo_epi8(even, odd));
+    store(16, _mm_unpackhi_epi8(even, odd));
+  } else {
+    __m128i p0 = _mm_shuffle_epi8(tables[0], nibbles);
+    __m128i p1 = _mm_shuffle_epi8(tables[1], nibbles);
+    __m128i p2 = _mm_shuffle_epi8(tables[2], nibbles);
+    __m128i p3 = _mm_shuffle_epi8(tables[3], nibbles);
+    __m128i low01 = _mm_unpacklo_epi8(p0, p1);
+    __m128i high01 = _mm_unpackhi_epi8(p0, p1);
+    __m128i low23 = _mm_unpacklo_epi8(p2, p3);
+    __m128i high23 = _mm_unpackhi_epi8(p2, p3);
+    store(0, _mm_unpacklo_epi16(low01, low23));
+    store(16, _mm_unpackhi_epi16(low01, low23));
+    store(32, _mm_unpacklo_epi16(high01, high23));
+    store(48, _mm_unpackhi_epi16(high01, high23));
   }
+}
+#endif
 
-  std::vector<uint8_t> encoded_data;
-  encoded_data.reserve(data.size());
+// unpacks one row of palette indices into pixels
+static void unpack_row(const uint8_t* src, size_t n_pixels, uint8_t* dst,
+                       const uint8_t* colors, uint8_t bits) {
+  const uint8_t mask = static_cast<uint8_t>((1 << bits) - 1);
   size_t i = 0;
-
-  while (i < data.size()) {
-    uint8_t current = data[i];
-    size_t count = 1;
-    while (i + count < data.size() && data[i + count] == current &&
-           count < 255 + 3) {
-      count++;
+#if USE_SIMD && defined(__SSSE3__)
+  // every nibble of the packed data selects pixels from small tables
+  const size_t pixels_per_nibble = 4 / bits;
+  __m128i tables[4];
+  for (size_t j = 0; j < pixels_per_nibble; j++) {
+    alignas(16) uint8_t table[16];
+    for (size_t nibble = 0; nibble < 16; nibble++) {
+      table[nibble] = colors[(nibble >> (j * bits)) & mask];
     }
+    tables[j] = _mm_load_si128(reinterpret_cast<const __m128i*>(table));
+  }
+  const __m128i low_nibbles = _mm_set1_epi8(0x0F);
+  const size_t pixels_per_chunk = 32 * pixels_per_nibble;
+  for (size_t in = 0; i + pixels_per_chunk <= n_pixels; in += 16) {
+    __m128i packed =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + in));
+    __m128i low = _mm_and_si128(packed, low_nibbles);
+    __m128i high = _mm_and_si128(_mm_srli_epi16(packed, 4), low_nibbles);
+    expand_nibbles(_mm_unpacklo_epi8(low, high), tables, pixels_per_nibble,
+                   dst + i);
+    expand_nibbles(_mm_unpackhi_epi8(low, high), tables, pixels_per_nibble,
+                   dst + i + pixels_per_chunk / 2);
+    i += pixels_per_chunk;
+  }
+#endif
+  for (; i < n_pixels; i++) {
+    size_t bit = i * bits;
+    dst[i] = colors[(src[bit / 8] >> (bit % 8)) & mask];
+  }
+}
 
-    if (count < 3) {
-      for (size_t j = 0; j < count; j++) {
-        encoded_data.push_back(current);
-      }
-    } else {
-      encoded_data.push_back(current);
-      encoded_data.push_back(current);
-      encoded_data.push_back(current);
-      encoded_data.push_back(static_cast<uint8_t>(count - 3));
-    }
-    i += count;
+void palette_pack(std::vector<uint8_t>& data, uint32_t& m_width,
+                  uint32_t& m_height, Palette& palette) {
+  palette.width = m_width;
+  palette.height = m_height;
+  // a single column is packed as one long row
+  size_t n_rows = m_width == 1 ? 1 : m_height;
+  size_t row_length = m_width == 1 ? m_height : m_width;
+  size_t packed_row = packed_row_size(row_length, palette.bits_per_pixel);
+
+  uint8_t index_of[256] = {};
+  for (size_t k = 0; k < palette.colors.size(); k++) {
+    index_of[palette.colors[k]] = static_cast<uint8_t>(k);
+  }
+  std::vector<uint8_t> packed_data(n_rows * packed_row);
+  for (size_t row = 0; row < n_rows; row++) {
+    pack_row(&data[row * row_length], row_length,
+             &packed_data[row * packed_row], palette, index_of);
   }
+  data = std::move(packed_data);
 
-  data.swap(encoded_data);
+  if (m_width == 1) {
+    m_height = static_cast<uint32_t>(packed_row);
+  } else {
+    m_width = static_cast<uint32_t>(packed_row);
+  }
 }
 
-void reverse_rle(std::vector<uint8_t>& data) {
-  if (data.empty()) {
-    return;
+void palette_unpack(std::vector<uint8_t>& data, const Palette& palette) {
+  size_t n_rows = palette.width == 1 ? 1 : palette.height;
+  size_t row_length = palette.width == 1 ? palette.height : palette.width;
+  size_t packed_row = packed_row_size(row_length, palette.bits_per_pixel);
+  if (data.size() != n_rows * packed_row) {
+    throw std::runtime_error(
+        "Error: Packed data size does not match the palette dimensions.");
   }
 
-  std::vector<uint8_t> decoded_data;
-  decoded_data.reserve(data.size() * 2);  // Conservative estimate
-  size_t i = 0;
+  // indices past the palette decode to zero instead of reading out of bounds
+  uint8_t colors[MAX_PALETTE_SIZE] = {};
+  std::copy_n(palette.colors.begin(),
+              std::min<size_t>(palette.colors.size(), MAX_PALETTE_SIZE),
+              colors);
+  std::vector<uint8_t> unpacked_data(n_rows * row_length);
+  for (size_t row = 0; row < n_rows; row++) {
+    unpack_row(&data[row * packed_row], row_length,
+               &unpacked_data[row * row_length], colors,
+               palette.bits_per_pixel);
+  }
+  data = std::move(unpacked_data);
+}
 
-  while (i < data.size()) {
-    if (i + 3 < data.size() && data[i] == data[i + 1] &&
-        data[i + 1] == data[i + 2]) {
-      uint8_t value = data[i];
-      uint8_t count = data[i + 3];
-      for (size_t j = 0; j < static_cast<size_t>(3) + count; j++) {
-        decoded_data.push_back(value);
-      }
-      i += 4;
-    } else {
-      decoded_data.push_back(data[i]);
-      i++;
+size_t run_length(const uint8_t* data, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  const uint8_t value = data[0];
+  size_t i = 1;
+#if USE_SIMD && defined(__AVX2__)
+  const __m256i needle = _mm256_set1_epi8(static_cast<char>(value));
+  for (; i + 32 <= size; i += 32) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    uint32_t equal = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+    if (equal != UINT32_MAX) {
+      return i + std::countr_one(equal);
     }
   }
-
-  data.swap(decoded_data);
+#elif USE_SIMD && defined(__SSE2__)
+  const __m128i needle = _mm_set1_epi8(static_cast<char>(value));
+  for (; i + 16 <= size; i += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    uint32_t equal = static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+    if (equal != UINT16_MAX) {
+      return i + std::countr_one(equal);
+    }
+  }
+#endif
+  while (i < size && data[i] == value) {
+    i++;
+  }
+  return i;
 }
 
 void mtf_transform(std::vector<uint8_t>& data) {
@@ -171,4 +332,317 @@ void reverse_mtf_transform(std::vector<uint8_t>& data) {
       std::rotate(dictionary.begin(), dict_it, dict_it + 1);
     }
   }
-}
\ No newline at end of file
+}
+
+// sets every bucket to the start (or the end) of its characters in the
+// suffix array
+static void bucket_bounds(const int32_t* s, size_t n,
+                          std::vector<int32_t>& bucket, bool end) {
+  std::fill(bucket.begin(), bucket.end(), 0);
+  for (size_t i = 0; i < n; i++) {
+    bucket[s[i]]++;
+  }
+  int32_t sum = 0;
+  for (auto& size : bucket) {
+    sum += size;
+    size = end ? sum : sum - size;
+  }
+}
+
+// induces the order of the L-type and then the S-type suffixes from the
+// seeded LMS suffixes
+static void induce_sort(const int32_t* s, int32_t* sa, size_t n,
+                        const std::vector<bool>& s_type,
+                        std::vector<int32_t>& bucket) {
+  bucket_bounds(s, n, bucket, false);
+  for (size_t i = 0; i < n; i++) {
+    int32_t j = sa[i] - 1;
+    if (sa[i] > 0 && !s_type[j]) {
+      sa[bucket[s[j]]++] = j;
+    }
+  }
+  bucket_bounds(s, n, bucket, true);
+  for (size_t i = n; i-- > 0;) {
+    int32_t j = sa[i] - 1;
+    if (sa[i] > 0 && s_type[j]) {
+      sa[--bucket[s[j]]] = j;
+    }
+  }
+}
+
+// SA-IS suffix array construction, the text has to end with a unique
+// smallest character 0 and use characters below alphabet_size
+static void suffix_array(const int32_t* s, int32_t* sa, size_t n,
+                         size_t alphabet_size) {
+  std::vector<bool> s_type(n, false);
+  s_type[n - 1] = true;
+  for (size_t i = n - 1; i-- > 0;) {
+    s_type[i] = s[i] < s[i + 1] || (s[i] == s[i + 1] && s_type[i + 1]);
+  }
+  auto is_lms = [&](int32_t i) { return i > 0 && s_type[i] && !s_type[i - 1]; };
+  std::vector<int32_t> bucket(alphabet_size);
+
+  // sort the LMS substrings by inducing from their bucket ends
+  bucket_bounds(s, n, bucket, true);
+  std::fill(sa, sa + n, -1);
+  for (size_t i = 1; i < n; i++) {
+    if (is_lms(i)) {
+      sa[--bucket[s[i]]] = i;
+    }
+  }
+  induce_sort(s, sa, n, s_type, bucket);
+
+  // move the sorted LMS substrings to the front and name them
+  size_t n1 = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (is_lms(sa[i])) {
+      sa[n1++] = sa[i];
+    }
+  }
+  std::fill(sa + n1, sa + n, -1);
+  int32_t name = 0;
+  int32_t previous = -1;
+  for (size_t i = 0; i < n1; i++) {
+    int32_t position = sa[i];
+    bool different = false;
+    for (size_t d = 0; d < n; d++) {
+      if (previous == -1 || s[position + d] != s[previous + d] ||
+          s_type[position + d] != s_type[previous + d]) {
+        different = true;
+        break;
+      }
+      if (d > 0 && (is_lms(position + d) || is_lms(previous + d))) {
+        break;
+      }
+    }
+    if (different) {
+      name++;
+      previous = position;
+    }
+    sa[n1 + position / 2] = name - 1;
+  }
+  for (size_t i = n, j = n; i-- > n1;) {
+    if (sa[i] >= 0) {
+      sa[--j] = sa[i];
+    }
+  }
+
+  // sort the LMS suffixes, recursing while their names are not unique
+  int32_t* reduced = sa + n - n1;
+  if (static_cast<size_t>(name) < n1) {
+    suffix_array(reduced, sa, n1, name);
+  } else {
+    for (size_t i = 0; i < n1; i++) {
+      sa[reduced[i]] = i;
+    }
+  }
+
+  // seed the sorted LMS suffixes and induce all the others
+  bucket_bounds(s, n, bucket, true);
+  for (size_t i = 1, j = 0; i < n; i++) {
+    if (is_lms(i)) {
+      reduced[j++] = i;
+    }
+  }
+  for (size_t i = 0; i < n1; i++) {
+    sa[i] = reduced[sa[i]];
+  }
+  std::fill(sa + n1, sa + n, -1);
+  for (size_t i = n1; i-- > 0;) {
+    int32_t j = sa[i];
+    sa[i] = -1;
+    sa[--bucket[s[j]]] = j;
+  }
+  induce_sort(s, sa, n, s_type, bucket);
+}
+
+size_t bwt_chain_count(size_t size) {
+  return std::clamp<size_t>(size / BWT_MIN_CHAIN_LEN, 1, BWT_CHAINS);
+}
+
+std::vector<uint32_t> bwt_transform(std::vector<uint8_t>& data) {
+  const size_t size = data.size();
+  if (size == 0) {
+    return std::vector<uint32_t>(bwt_chain_count(size), 0);
+  }
+  if (size >= INT32_MAX) {
+    throw std::runtime_error("Error: Block is too large for the BWT.");
+  }
+  // shift the bytes up to make room for the sentinel
+  std::vector<int32_t> text(size + 1);
+  for (size_t i = 0; i < size; i++) {
+    text[i] = data[i] + 1;
+  }
+  text[size] = 0;
+  std::vector<int32_t> sa(size + 1);
+  suffix_array(text.data(), sa.data(), size + 1, 256 + 1);
+
+  // the last column without the sentinel, the row of the suffix starting a
+  // chain is where the inverse begins to walk it
+  const size_t chain_length = (size + bwt_chain_count(size) - 1) /
+                              bwt_chain_count(size);
+  std::vector<uint32_t> chain_rows(bwt_chain_count(size));
+  size_t o = 0;
+  for (size_t i = 0; i <= size; i++) {
+    size_t suffix = static_cast<size_t>(sa[i]);
+    if (suffix < size && suffix % chain_length == 0) {
+      chain_rows[suffix / chain_length] = static_cast<uint32_t>(i);
+    }
+    if (suffix != 0) {
+      data[o++] = static_cast<uint8_t>(text[suffix - 1] - 1);
+    }
+  }
+  return chain_rows;
+}
+
+// every entry holds the next row above the low 8 bits with the byte of the
+// current row, so each step touches one table at a single random location
+template <typename entry_t>
+static void reverse_bwt_walk(std::vector<uint8_t>& data,
+                             const std::vector<uint32_t>& chain_rows) {
+  const size_t size = data.size();
+  const size_t primary_index = chain_rows[0];
+  size_t start[256] = {};
+  for (uint8_t byte : data) {
+    start[byte]++;
+  }
+  // row 0 belongs to the sentinel
+  size_t sum = 1;
+  for (auto& count : start) {
+    sum += count;
+    count = sum - count;
+  }
+
+  std::vector<entry_t> rows(size + 1);
+  for (size_t row = 0; row <= size; row++) {
+    if (row == primary_index) {
+      continue;
+    }
+    uint8_t byte = data[row < primary_index ? row : row - 1];
+    rows[start[byte]++] = (static_cast<entry_t>(row) << 8) | byte;
+  }
+
+  // the chains are independent, walking them together overlaps the misses
+  const size_t n_chains = chain_rows.size();
+  const size_t chain_length = (size + n_chains - 1) / n_chains;
+  size_t current[BWT_CHAINS];
+  std::copy(chain_rows.begin(), chain_rows.end(), current);
+  for (size_t i = 0; i < chain_length; i++) {
+    for (size_t chain = 0; chain < n_chains; chain++) {
+      size_t position = chain * chain_length + i;
+      if (position >= size) {
+        break;
+      }
+      entry_t entry = rows[current[chain]];
+      data[position] = static_cast<uint8_t>(entry);
+      current[chain] = static_cast<size_t>(entry >> 8);
+    }
+  }
+}
+
+void reverse_bwt_transform(std::vector<uint8_t>& data,
+                           const std::vector<uint32_t>& chain_rows) {
+  if (data.empty()) {
+    return;
+  }
+  if (chain_rows.size() != bwt_chain_count(data.size()) ||
+      chain_rows[0] == 0) {
+    throw std::runtime_error("BWT Decode Error: Invalid primary index.");
+  }
+  for (uint32_t row : chain_rows) {
+    if (row > data.size()) {
+      throw std::runtime_error("BWT Decode Error: Invalid chain row.");
+    }
+  }
+  if (data.size() < (1U << 24)) {
+    reverse_bwt_walk<uint32_t>(data, chain_rows);
+  } else {
+    reverse_bwt_walk<uint64_t>(data, chain_rows);
+  }
+}
+
+void delta_encode_scalar(uint8_t* data, size_t size) {
+  if (size < 2) {
+    return;
+  }
+  uint8_t prev_original = data[0];
+  for (size_t i = 1; i < size; i++) {
+    uint8_t current_original = data[i];
+    data[i] = static_cast<uint8_t>(current_original - prev_original);
+    prev_original = current_original;
+  }
+}
+
+void delta_decode_scalar(uint8_t* data, size_t size) {
+  for (size_t i = 1; i < size; i++) {
+    data[i] = static_cast<uint8_t>(data[i] + data[i - 1]);
+  }
+}
+
+void delta_encode(uint8_t* data, size_t size) {
+  size_t i = size;
+#if USE_SIMD && defined(__AVX2__)
+  // walk backwards so every vector still subtracts the original predecessor
+  while (i >= 32 + 1) {
+    i -= 32;
+    __m256i current =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    __m256i previous =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i - 1));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i),
+                        _mm256_sub_epi8(current, previous));
+  }
+#elif USE_SIMD && defined(__SSE2__)
+  while (i >= 16 + 1) {
+    i -= 16;
+    __m128i current =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    __m128i previous =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i - 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i),
+                     _mm_sub_epi8(current, previous));
+  }
+#endif
+  // the untouched head (or everything without SIMD)
+  delta_encode_scalar(data, i);
+}
+
+void delta_decode(uint8_t* data, size_t size) {
+  size_t i = 0;
+#if USE_SIMD && defined(__AVX2__)
+  const __m256i broadcast_last = _mm256_set1_epi8(15);
+  __m256i carry = _mm256_setzero_si256();
+  for (; i + 32 <= size; i += 32) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    // log-step prefix sum inside each 128-bit lane
+    x = _mm256_add_epi8(x, _mm256_slli_si256(x, 1));
+    x = _mm256_add_epi8(x, _mm256_slli_si256(x, 2));
+    x = _mm256_add_epi8(x, _mm256_slli_si256(x, 4));
+    x = _mm256_add_epi8(x, _mm256_slli_si256(x, 8));
+    // add the low lane total to the high lane
+    __m256i low_lane = _mm256_permute2x128_si256(x, x, 0x08);
+    x = _mm256_add_epi8(x, _mm256_shuffle_epi8(low_lane, broadcast_last));
+    // add the running total of the previous vectors
+    x = _mm256_add_epi8(x, carry);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), x);
+    carry = _mm256_shuffle_epi8(_mm256_permute2x128_si256(x, x, 0x11),
+                                broadcast_last);
+  }
+#elif USE_SIMD && defined(__SSE2__)
+  __m128i carry = _mm_setzero_si128();
+  for (; i + 16 <= size; i += 16) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 1));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 2));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+    x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+    x = _mm_add_epi8(x, carry);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), x);
+    carry = _mm_set1_epi8(static_cast<char>(data[i + 15]));
+  }
+#endif
+  // finish the tail that did not fill a whole vector
+  for (i = std::max<size_t>(i, 1); i < size; i++) {
+    data[i] = static_cast<uint8_t>(data[i] + data[i - 1]);
+  }
+}
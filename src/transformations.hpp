@@ -15,39 +15,68 @@
 #ifndef TRANSFORMATIONS_HPP
 #define TRANSFORMATIONS_HPP
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
 /**
- * @brief Applies Run-Length Encoding (RLE) with no explicit marker to the data.
- * @param data The input data vector, which will be modified in-place.
+ * @brief Counts how many bytes from the start of the data are equal to the
+ * first byte. Uses AVX2/SSE2 compares when available.
+ * @param data Pointer to the start of the run.
+ * @param size Maximum number of bytes to examine.
+ * @return Length of the run (0 for empty data).
+ */
+size_t run_length(const uint8_t* data, size_t size);
+
+/**
+ * @brief Palette of a low-cardinality image whose pixels are packed into
+ * 1, 2 or 4 bit indices.
  */
-void rle(std::vector<uint8_t>& data);
+struct Palette {
+  uint8_t bits_per_pixel = 0;   // 0 when the data are not packed
+  std::vector<uint8_t> colors;  // pixel values in ascending order
+  uint32_t width = 0;           // dimensions of the data before packing
+  uint32_t height = 0;
+};
 
 /**
- * @brief Reverses Run-Length Encoding (RLE) with no explicit marker on the
- * data.
- * @param data The RLE encoded data vector, which will be modified in-place.
+ * @brief Collects the distinct byte values of the data with a SIMD scan and
+ * picks the smallest bit depth able to index them.
+ * @param data Pointer to the data.
+ * @param size Number of bytes to scan.
+ * @param palette Palette filled with the sorted colors and the bit depth.
+ * @return True if the data contain at most MAX_PALETTE_SIZE distinct values.
  */
-void reverse_rle(std::vector<uint8_t>& data);
+bool build_palette(const uint8_t* data, size_t size, Palette& palette);
 
 /**
- * @brief Packs binary data (0x00 or 0xFF) into bits of bytes.
- * It also adjusts width, height, and expected size accordingly.
- * @param data The input data vector (containing 0x00 or 0xFF), modified
- * in-place.
+ * @brief Computes the number of bytes taken by a packed row.
+ * @param n_pixels Number of pixels in the row.
+ * @param bits_per_pixel Bit depth of the packed indices.
+ * @return Size of the packed row in bytes.
+ */
+size_t packed_row_size(size_t n_pixels, uint8_t bits_per_pixel);
+
+/**
+ * @brief Replaces every row of the data by the packed palette indices of its
+ * pixels, the first pixel in the least significant bits of a byte. Data of
+ * width 1 are packed as a single row. Uses SSSE3 kernels when available.
+ * @param data The input data vector, modified in-place.
  * @param m_width The width of the data, adjusted after packing.
  * @param m_height The height of the data, adjusted after packing.
- * @param expected_size The expected size of the data after packing.
+ * @param palette Palette built by build_palette, the original dimensions are
+ * stored into it.
  */
-void binary_only_pack(std::vector<uint8_t>& data, uint32_t& m_width,
-                      uint32_t& m_height, uint64_t& expected_size);
+void palette_pack(std::vector<uint8_t>& data, uint32_t& m_width,
+                  uint32_t& m_height, Palette& palette);
 
 /**
- * @brief Unpacks data that was previously packed by binary_only_pack.
+ * @brief Unpacks data that were previously packed by palette_pack. Uses SSSE3
+ * kernels when available.
  * @param data The packed data vector, which will be modified in-place.
+ * @param palette Palette with the bit depth and the original dimensions.
  */
-void binary_only_unpack(std::vector<uint8_t>& data);
+void palette_unpack(std::vector<uint8_t>& data, const Palette& palette);
 
 /**
  * @brief Applies Move-to-Front (MTF) transformation to the data.
@@ -61,4 +90,61 @@ void mtf_transform(std::vector<uint8_t>& data);
  */
 void reverse_mtf_transform(std::vector<uint8_t>& data);
 
+/**
+ * @brief Computes the number of independent chains the inverse BWT of a block
+ * walks at once, at most BWT_CHAINS of at least BWT_MIN_CHAIN_LEN bytes.
+ * @param size Size of the block in bytes.
+ * @return Number of chains, at least 1.
+ */
+size_t bwt_chain_count(size_t size);
+
+/**
+ * @brief Applies the Burrows-Wheeler transform to the data in-place. The
+ * suffix array is built in linear time with SA-IS.
+ * @param data The input data vector, which will be modified in-place.
+ * @return Rows at which the chains of the inverse start, the first one is the
+ * primary index.
+ */
+std::vector<uint32_t> bwt_transform(std::vector<uint8_t>& data);
+
+/**
+ * @brief Reverses the Burrows-Wheeler transform in-place. The chains are
+ * walked interleaved over a single table holding both the next row and the
+ * output byte, so their cache misses overlap.
+ * @param data The BWT transformed data vector, modified in-place.
+ * @param chain_rows The rows returned by bwt_transform.
+ */
+void reverse_bwt_transform(std::vector<uint8_t>& data,
+                           const std::vector<uint32_t>& chain_rows);
+
+/**
+ * @brief Applies delta transformation (difference of neighbouring bytes)
+ * in-place. Uses AVX2/SSE2 kernels when available.
+ * @param data Pointer to the data, which will be modified in-place.
+ * @param size Number of bytes to transform.
+ */
+void delta_encode(uint8_t* data, size_t size);
+
+/**
+ * @brief Reverses the delta transformation in-place (byte prefix sum). Uses
+ * AVX2/SSE2 kernels when available.
+ * @param data Pointer to the delta encoded data, modified in-place.
+ * @param size Number of bytes to transform.
+ */
+void delta_decode(uint8_t* data, size_t size);
+
+/**
+ * @brief Scalar reference implementation of delta_encode.
+ * @param data Pointer to the data, which will be modified in-place.
+ * @param size Number of bytes to transform.
+ */
+void delta_encode_scalar(uint8_t* data, size_t size);
+
+/**
+ * @brief Scalar reference implementation of delta_decode.
+ * @param data Pointer to the delta encoded data, modified in-place.
+ * @param size Number of bytes to transform.
+ */
+void delta_decode_scalar(uint8_t* data, size_t size);
+
 #endif  // TRANSFORMATIONS_HPP